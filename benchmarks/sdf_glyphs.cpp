@@ -0,0 +1,162 @@
+//
+// Created by pugemon on 16.10.26.
+//
+// Compares glyphs rendered from distance fields, what sdfText enables, with
+// glyphs rasterized by stb_truetype. For every size it prints how far the
+// 4 bit coverage of the two differs and what an atlas miss costs each way,
+// then how long generating a distance field takes.
+//
+// Usage: bench_sdf_glyphs font.ttf
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <switch.h>
+
+#include "nikola/tesla/glyph_cache.hpp"
+#include "nikola/tesla/sdf_glyph_cache.hpp"
+
+// The library gets it from tesla.hpp, which needs all of libnx
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "nikola/stb_truetype.h"
+
+using namespace tsl::gfx;
+
+namespace
+{
+
+constexpr const char* Text =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789.,:;!?%&@()";
+constexpr float PixelHeights[] = {12, 15, 18, 20, 23, 28, 34, 48, 64};
+
+bool readFile(const char* path, std::vector<unsigned char>& data)
+{
+  FILE* file = std::fopen(path, "rb");
+  if (file == nullptr)
+    return false;
+
+  std::fseek(file, 0, SEEK_END);
+  data.resize(std::ftell(file));
+  std::rewind(file);
+
+  const bool read =
+      std::fread(data.data(), 1, data.size(), file) == data.size();
+  std::fclose(file);
+
+  return read && !data.empty();
+}
+
+u8 coverageAt(const GlyphCache::Glyph& glyph, u32 x, u32 y)
+{
+  const u8 packed = glyph.coverage[y * ((glyph.width + 1) / 2) + x / 2];
+
+  return (packed >> ((x & 1) * 4)) & 0xF;
+}
+
+/**
+ * @brief Times filling an empty atlas with every glyph of the text
+ *
+ * @return Microseconds per glyph
+ */
+double measureMisses(GlyphCache& cache,
+                     const stbtt_fontinfo* font,
+                     float scale)
+{
+  constexpr int Repeats = 200;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < Repeats; i++) {
+    cache.clear();
+    for (const char* c = Text; *c != '\0'; c++)
+      cache.get(font, *c, scale);
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::micro>(end - start).count()
+      / (Repeats * std::strlen(Text));
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  if (argc != 2) {
+    std::fprintf(stderr, "usage: %s font.ttf\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<unsigned char> data;
+  stbtt_fontinfo font;
+  if (!readFile(argv[1], data)
+      || !stbtt_InitFont(
+          &font, data.data(), stbtt_GetFontOffsetForIndex(data.data(), 0)))
+  {
+    std::fprintf(stderr, "%s: can't load font\n", argv[1]);
+    return 1;
+  }
+
+  SdfGlyphCache fields;
+  fields.setCapacity(0x100000);
+
+  std::printf("size   mean |err|  max err  miss: stbtt   miss: sdf\n");
+
+  for (const float pixelHeight : PixelHeights) {
+    const float scale = stbtt_ScaleForPixelHeight(&font, pixelHeight);
+
+    GlyphCache rasterized, rendered;
+    rasterized.setCapacity(0x80000);
+    rendered.setCapacity(0x80000);
+    rendered.setDistanceFields(&fields);
+
+    u64 errorSum = 0, pixels = 0;
+    u32 maxError = 0;
+
+    for (const char* c = Text; *c != '\0'; c++) {
+      const GlyphCache::Glyph& expected = rasterized.get(&font, *c, scale);
+      const GlyphCache::Glyph& actual = rendered.get(&font, *c, scale);
+
+      if (actual.width != expected.width || actual.height != expected.height
+          || actual.xOffset != expected.xOffset
+          || actual.yOffset != expected.yOffset)
+      {
+        std::fprintf(stderr, "'%c': bitmap boxes differ\n", *c);
+        return 1;
+      }
+
+      for (u32 y = 0; y < expected.height; y++)
+        for (u32 x = 0; x < expected.width; x++) {
+          const u32 error =
+              std::abs(coverageAt(actual, x, y) - coverageAt(expected, x, y));
+          errorSum += error;
+          maxError = std::max(maxError, error);
+          pixels++;
+        }
+    }
+
+    std::printf("%2.0f px  %.2f/15     %-2u       %5.1f us      %5.1f us\n",
+                pixelHeight,
+                double(errorSum) / pixels,
+                maxError,
+                measureMisses(rasterized, &font, scale),
+                measureMisses(rendered, &font, scale));
+  }
+
+  constexpr int Repeats = 20;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < Repeats; i++) {
+    fields.clear();
+    for (const char* c = Text; *c != '\0'; c++)
+      fields.get(&font, *c);
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  std::printf("field generation: %.0f us per glyph\n",
+              std::chrono::duration<double, std::micro>(end - start).count()
+                  / (Repeats * std::strlen(Text)));
+
+  return 0;
+}
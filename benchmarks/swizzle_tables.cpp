@@ -0,0 +1,124 @@
+//
+// Created by pugemon on 16.10.26.
+//
+// Compares addressing the block linear framebuffer through the per row and
+// per column tables Renderer::initSwizzleTables builds with computing every
+// offset from scratch, the way getPixelOffset used to. Also checks that both
+// agree for every pixel.
+//
+// Usage: bench_swizzle_tables [width height]
+//
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+
+// The old getPixelOffset, without the scissor test
+uint32_t computeOffset(uint32_t x, uint32_t y, uint32_t width)
+{
+  uint32_t tmpPos = ((y & 127) / 16) + (x / 32 * 8)
+      + ((y / 16 / 8) * (((width / 2) / 16 * 8)));
+  tmpPos *= 16 * 16 * 4;
+
+  tmpPos += ((y % 16) / 8) * 512 + ((x % 32) / 16) * 256 + ((y % 8) / 2) * 64
+      + ((x % 16) / 8) * 32 + (y % 2) * 16 + (x % 8) * 2;
+
+  return tmpPos / 2;
+}
+
+// Same as Renderer::initSwizzleTables
+void buildTables(uint32_t width,
+                 uint32_t height,
+                 std::vector<uint32_t>& rowOffsets,
+                 std::vector<uint32_t>& columnOffsets)
+{
+  const uint32_t blocksPer128Rows = (width / 2) / 16 * 8;
+
+  rowOffsets.resize(height);
+  for (uint32_t y = 0; y < height; y++)
+    rowOffsets[y] = (((y & 127) / 16) + (y / 128) * blocksPer128Rows) * 512
+        + ((y % 16) / 8) * 256 + ((y % 8) / 2) * 32 + (y % 2) * 8;
+
+  columnOffsets.resize(width);
+  for (uint32_t x = 0; x < width; x++)
+    columnOffsets[x] = (x / 32) * 8 * 512 + ((x % 32) / 16) * 128
+        + ((x % 16) / 8) * 16 + (x % 8);
+}
+
+template<typename Fill>
+double measure(Fill fill)
+{
+  constexpr int Frames = 200;
+
+  fill();  // Warm up
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int frame = 0; frame < Frames; frame++)
+    fill();
+  const auto end = std::chrono::steady_clock::now();
+
+  return std::chrono::duration<double, std::micro>(end - start).count()
+      / Frames;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  uint32_t width = 448, height = 720;
+  if (argc == 3) {
+    width = std::atoi(argv[1]);
+    height = std::atoi(argv[2]);
+  }
+
+  if (width == 0 || width % 32 != 0 || height == 0) {
+    std::fprintf(stderr, "width has to be a multiple of 32\n");
+    return 1;
+  }
+
+  std::vector<uint32_t> rowOffsets, columnOffsets;
+  buildTables(width, height, rowOffsets, columnOffsets);
+
+  for (uint32_t y = 0; y < height; y++)
+    for (uint32_t x = 0; x < width; x++)
+      if (rowOffsets[y] + columnOffsets[x] != computeOffset(x, y, width)) {
+        std::fprintf(stderr, "offsets differ at %u, %u\n", x, y);
+        return 1;
+      }
+
+  // Writes every pixel once per frame, in the order the renderer fills rects.
+  // Block linear buffers are padded to whole blocks of 128 rows
+  std::vector<uint16_t> framebuffer((height + 127) / 128 * 128 * width);
+  volatile uint16_t color = 0xF123;
+
+  const double computed = measure(
+      [&]
+      {
+        for (uint32_t y = 0; y < height; y++)
+          for (uint32_t x = 0; x < width; x++)
+            framebuffer[computeOffset(x, y, width)] = color;
+      });
+
+  const double tables = measure(
+      [&]
+      {
+        for (uint32_t y = 0; y < height; y++) {
+          uint16_t* row = framebuffer.data() + rowOffsets[y];
+          for (uint32_t x = 0; x < width; x++)
+            row[columnOffsets[x]] = color;
+        }
+      });
+
+  std::printf("%ux%u, per frame: computed %.1f us, tables %.1f us (%.2fx)\n",
+              width,
+              height,
+              computed,
+              tables,
+              computed / tables);
+
+  return 0;
+}
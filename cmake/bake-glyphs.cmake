@@ -0,0 +1,55 @@
+# ---- Baked glyphs ----
+
+# Rasterizes common glyphs at the standard UI sizes into a header compiled into
+# the library, so the first frames don't have to rasterize any text. The
+# shared fonts only exist on the console, dump them and point these at the
+# files. Glyphs of fonts that differ at runtime are ignored
+set(NIKOLA_STD_FONT "" CACHE FILEPATH "Standard shared font (TTF)")
+set(NIKOLA_EXT_FONT "" CACHE FILEPATH "Nintendo extended shared font (TTF)")
+set(
+        NIKOLA_BAKED_SIZES "15;20;23;30"
+        CACHE STRING "Pixel heights to bake glyphs at"
+)
+
+foreach(font NIKOLA_STD_FONT NIKOLA_EXT_FONT)
+    if(NOT EXISTS "${${font}}")
+        message(FATAL_ERROR "NIKOLA_BAKE_GLYPHS needs ${font} set to a font")
+    endif()
+endforeach()
+
+# The baker runs on the build machine, not with the Switch toolchain
+find_program(
+        NIKOLA_HOST_CXX NAMES c++ g++ clang++
+        NO_CMAKE_FIND_ROOT_PATH
+)
+if(NOT NIKOLA_HOST_CXX)
+    message(FATAL_ERROR "NIKOLA_BAKE_GLYPHS needs a host C++ compiler")
+endif()
+
+set(baker "${PROJECT_BINARY_DIR}/glyph_baker")
+set(atlas "${PROJECT_BINARY_DIR}/generated/nikola/baked_glyph_atlas.hpp")
+
+add_custom_command(
+        OUTPUT "${baker}"
+        COMMAND "${NIKOLA_HOST_CXX}" -std=c++17 -O2
+        -I "${PROJECT_SOURCE_DIR}/include"
+        "${PROJECT_SOURCE_DIR}/tools/glyph_baker.cpp" -o "${baker}"
+        DEPENDS "${PROJECT_SOURCE_DIR}/tools/glyph_baker.cpp"
+        COMMENT "Building the glyph baker"
+        VERBATIM
+)
+add_custom_command(
+        OUTPUT "${atlas}"
+        COMMAND "${baker}" "${NIKOLA_STD_FONT}" "${NIKOLA_EXT_FONT}" "${atlas}"
+        ${NIKOLA_BAKED_SIZES}
+        DEPENDS "${baker}" "${NIKOLA_STD_FONT}" "${NIKOLA_EXT_FONT}"
+        COMMENT "Baking glyphs"
+        VERBATIM
+)
+
+target_sources(libnikola_libnikola PRIVATE "${atlas}")
+target_include_directories(
+        libnikola_libnikola PRIVATE
+        "${PROJECT_BINARY_DIR}/generated"
+)
+target_compile_definitions(libnikola_libnikola PRIVATE NIKOLA_BAKED_GLYPHS)
@@ -1,10 +1,20 @@
 include(cmake/folders.cmake)
 
+include(CTest)
+if(BUILD_TESTING)
+    add_subdirectory(tests)
+endif()
+
 option(BUILD_MCSS_DOCS "Build documentation using Doxygen and m.css" OFF)
 if(BUILD_MCSS_DOCS)
     include(cmake/docs.cmake)
 endif()
 
+option(NIKOLA_BUILD_BENCHMARKS "Build the host benchmarks" OFF)
+if(NIKOLA_BUILD_BENCHMARKS)
+    add_subdirectory(benchmarks)
+endif()
+
 include(cmake/lint-targets.cmake)
 include(cmake/spell-targets.cmake)
 
@@ -0,0 +1,39 @@
+# ---- Host executables ----
+
+# Tests and benchmarks run on the build machine, so they get compiled with its
+# compiler instead of the Switch toolchain. They see the public headers and
+# tools/host, which stands in for the parts of libnx the headers need
+find_program(
+        NIKOLA_HOST_CXX NAMES c++ g++ clang++
+        NO_CMAKE_FIND_ROOT_PATH
+)
+
+# nikola_add_host_executable(<name> SOURCES <file>... [OPTIONS <flag>...])
+#
+# Builds <name> from the given sources, relative to the project root, as part
+# of the all target. The path of the executable is stored in <name>_PATH
+function(nikola_add_host_executable name)
+    cmake_parse_arguments(PARSE_ARGV 1 arg "" "" "SOURCES;OPTIONS")
+
+    if(NOT NIKOLA_HOST_CXX)
+        message(FATAL_ERROR "${name} needs a host C++ compiler")
+    endif()
+
+    list(TRANSFORM arg_SOURCES PREPEND "${PROJECT_SOURCE_DIR}/")
+    set(output "${CMAKE_CURRENT_BINARY_DIR}/${name}")
+
+    add_custom_command(
+            OUTPUT "${output}"
+            COMMAND "${NIKOLA_HOST_CXX}" -std=c++20 -O2 -Wall -Wextra
+            ${arg_OPTIONS}
+            -I "${PROJECT_SOURCE_DIR}/tools/host"
+            -I "${PROJECT_SOURCE_DIR}/include"
+            ${arg_SOURCES} -o "${output}" -pthread
+            DEPENDS ${arg_SOURCES}
+            COMMENT "Building ${name} for the host"
+            VERBATIM
+    )
+    add_custom_target("${name}" ALL DEPENDS "${output}")
+
+    set("${name}_PATH" "${output}" PARENT_SCOPE)
+endfunction()
@@ -17,6 +17,67 @@ public:
   }
 };
 
+// Draws a typical menu alternately into the swizzled framebuffer and into the
+// linear back buffer, then shows the average render time of both
+class GuiBenchmark : public tsl::Gui {
+public:
+    static constexpr u32 FramesPerMode = 120;
+
+    GuiBenchmark() : m_linearRendering(linearRendering), m_partialRedraw(partialRedraw), m_sdfText(sdfText) {}
+
+    ~GuiBenchmark() override {
+        linearRendering = m_linearRendering;
+        partialRedraw = m_partialRedraw;
+        sdfText = m_sdfText;
+    }
+
+    tsl::elm::Element* createUI() override {
+        auto frame = new tsl::elm::OverlayFrame("Nikola Example", "v1.4.0 - Benchmark");
+        auto list = new tsl::elm::List();
+
+        m_swizzledItem = new tsl::elm::ListItem("Swizzled framebuffer");
+        m_linearItem = new tsl::elm::ListItem("Linear back buffer");
+        list->addItem(m_swizzledItem);
+        list->addItem(m_linearItem);
+
+        // Renders text from distance fields to compare it with the rasterizer
+        auto *sdfItem = new tsl::elm::ToggleListItem("Distance field text", sdfText);
+        sdfItem->setStateChangedListener([](bool state) { sdfText = state; });
+        list->addItem(sdfItem);
+
+        for (u32 i = 0; i < 8; i++) {
+            auto *item = new tsl::elm::ListItem("Menu item " + std::to_string(i));
+            item->setValue(std::to_string(i * 100) + " MHz");
+            list->addItem(item);
+        }
+
+        frame->setContent(list);
+        return frame;
+    }
+
+    virtual void update() override {
+        // Redraw everything every frame so both modes do the same work
+        partialRedraw = false;
+
+        if (++m_frames < FramesPerMode)
+            return;
+
+        auto &renderer = tsl::gfx::Renderer::getRenderer();
+        const u64 renderTime = renderer.getFrameStats().averageRenderTime / 1000;
+        (linearRendering ? m_linearItem : m_swizzledItem)->setValue(std::to_string(renderTime) + " us");
+
+        // Takes effect on the next frame, which starts with fresh counters
+        linearRendering = !linearRendering;
+        renderer.resetFrameStats();
+        m_frames = 0;
+    }
+
+private:
+    bool m_linearRendering, m_partialRedraw, m_sdfText;
+    tsl::elm::ListItem *m_swizzledItem = nullptr, *m_linearItem = nullptr;
+    u32 m_frames = 0;
+};
+
 class GuiTest : public tsl::Gui {
 public:
     GuiTest(u8 arg1, u8 arg2, bool arg3) { }
@@ -44,6 +105,18 @@ public:
 
         list->addItem(clickableListItem);
         list->addItem(new tsl::elm::ListItem("Default List Item"));
+
+        auto *benchmarkListItem = new tsl::elm::ListItem("Rendering Benchmark");
+        benchmarkListItem->setClickListener([](u64 keys) {
+            if (keys & HidNpadButton_A) {
+                tsl::changeTo<GuiBenchmark>();
+                return true;
+            }
+
+            return false;
+        });
+
+        list->addItem(benchmarkListItem);
         list->addItem(new tsl::elm::ListItem("Default List Item with an extra long name to trigger truncation and scrolling"));
         list->addItem(new tsl::elm::ToggleListItem("Toggle List Item", true));
 
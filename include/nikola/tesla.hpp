@@ -91,6 +91,17 @@ inline PadState pad;
 inline uint16_t framebufferWidth = 448;
 inline uint16_t framebufferHeight = 720;
 inline bool deactivateOriginalFooter = false;
+inline u32 glyphCacheSize = 0x40000;  ///< Glyph atlas size in bytes
+inline bool partialRedraw =
+    false;  ///< Only redraw areas elements marked, see Element::markDirty
+inline tsl::gfx::PacingMode framePacing =
+    tsl::gfx::PacingMode::VSync;  ///< How frames are timed
+inline u8 renderThreads = 1;  ///< Threads rasterizing a frame in tiles
+inline bool linearRendering =
+    false;  ///< Draw row major and swizzle when presenting
+inline bool sdfText = false;  ///< Render text from glyph distance fields
+inline const char* glyphCacheFile =
+    "sdmc:/config/tesla/glyph_cache.bin";  ///< Glyphs kept across launches
 
 namespace tsl
 {
@@ -413,7 +424,12 @@ private:
     newGui->m_topElement = newGui->createUI();
     newGui->requestFocus(newGui->m_topElement, FocusDirection::None);
 
+    // Rasterize the new text in idle time instead of when it gets drawn
+    if (newGui->m_topElement != nullptr)
+      newGui->m_topElement->prewarmGlyphs(&gfx::Renderer::get());
+
     this->m_guiStack.push(std::move(newGui));
+    gfx::Renderer::get().addFullDamage();
 
     return this->m_guiStack.top();
   }
@@ -0,0 +1,45 @@
+//
+// Created by pugemon on 16.10.26.
+//
+
+#ifndef LIBNIKOLA_BAKED_GLYPHS_HPP
+#define LIBNIKOLA_BAKED_GLYPHS_HPP
+
+#include <switch.h>
+
+#include "../stb_truetype.h"
+#include "font_metrics.hpp"
+#include "glyph_cache.hpp"
+
+namespace tsl::gfx
+{
+
+/**
+ * @brief A glyph rasterized at build time by tools/glyph_baker.cpp
+ */
+struct BakedGlyph
+{
+  u32 codepoint;
+  u8 font;  ///< Font index in \ref FontMetrics fallback order
+  u8 pixelHeight;  ///< Text height the glyph was rasterized for
+  s16 xOffset, yOffset;  ///< Offset of the bitmap from the glyph origin
+  u16 width, height;  ///< Size of the bitmap in pixels
+  u32 offset;  ///< Offset of the 4 bit coverage in the baked coverage
+};
+
+/**
+ * @brief Pins the glyphs baked into the library into a glyph cache, so the
+ * first frames draw common text without rasterizing anything
+ * @note Glyphs are only baked when the library is built with
+ * NIKOLA_BAKE_GLYPHS. Glyphs of a font that doesn't match the one they were
+ * baked from are skipped and get rasterized as usual
+ *
+ * @param cache Glyph cache to pin the glyphs into
+ * @param metrics Metrics holding the fonts text is drawn with
+ * @return Number of pinned glyphs
+ */
+u32 pinBakedGlyphs(GlyphCache& cache, const FontMetrics& metrics);
+
+}  // namespace tsl::gfx
+
+#endif  // LIBNIKOLA_BAKED_GLYPHS_HPP
@@ -0,0 +1,109 @@
+//
+// Created by pugemon on 16.10.26.
+//
+
+#ifndef LIBNIKOLA_BLEND_HPP
+#define LIBNIKOLA_BLEND_HPP
+
+#include <switch.h>
+
+#include "gfx.hpp"
+
+namespace tsl::gfx::blend
+{
+
+/**
+ * @brief Destination blends a single color over a run of RGBA4444 pixels. The
+ * resulting pixels take over the alpha of the color, same as \ref
+ * Renderer::setPixelBlendDst
+ *
+ * @param dst First pixel of the run
+ * @param count Number of pixels in the run
+ * @param color Color
+ */
+void fill(u16* dst, u32 count, Color color);
+
+/**
+ * @brief Source blends a run of RGBA4444 pixels, each with its own alpha, over
+ * a run of RGBA4444 pixels. The destination keeps its alpha, same as \ref
+ * Renderer::setPixelBlendSrc
+ *
+ * @param dst First destination pixel of the run
+ * @param src First source pixel of the run
+ * @param count Number of pixels in the run
+ */
+void span(u16* dst, const u16* src, u32 count);
+
+/**
+ * @brief Source blends a single color over a run of RGBA4444 pixels with the
+ * color's alpha scaled by a 8 bit coverage value per pixel. The destination
+ * keeps its alpha
+ *
+ * @param dst First destination pixel of the run
+ * @param coverage First coverage value of the run
+ * @param count Number of pixels in the run
+ * @param color Color
+ */
+void mask(u16* dst, const u8* coverage, u32 count, Color color);
+
+/**
+ * @brief Blend results of a single color for every 4 bit coverage value and
+ * every destination channel value, so blending a glyph takes no arithmetic
+ * per pixel
+ */
+struct CoverageTable
+{
+  Color color = 0;
+  u16 red[16 * 16];  ///< Indexed by coverage << 4 | destination red
+  u16 green[16 * 16];  ///< Same, already shifted into place
+  u16 blue[16 * 16];  ///< Same, already shifted into place
+
+  CoverageTable() { this->build(this->color); }
+
+  /**
+   * @brief Fills the tables for a color
+   *
+   * @param color Color
+   */
+  void build(Color color);
+};
+
+/**
+ * @brief Source blends a single color over a run of RGBA4444 pixels like
+ * \ref mask, with a 4 bit coverage value per pixel and the blending looked
+ * up from a table. The destination keeps its alpha
+ *
+ * @param dst First destination pixel of the run
+ * @param coverage First coverage value of the run, 0 - 15
+ * @param count Number of pixels in the run
+ * @param table Table built for the color
+ */
+void coverage(u16* dst,
+              const u8* coverage,
+              u32 count,
+              const CoverageTable& table);
+
+/**
+ * @brief Copies the color channels of a run of opaque RGBA4444 pixels. The
+ * destination keeps its alpha, which gives the same result as \ref span
+ *
+ * @param dst First destination pixel of the run
+ * @param src First source pixel of the run
+ * @param count Number of pixels in the run
+ */
+void copy(u16* dst, const u16* src, u32 count);
+
+/**
+ * @brief Source blends a run of premultiplied RGBA4444 pixels over a run of
+ * RGBA4444 pixels. The destination keeps its alpha
+ *
+ * @param dst First destination pixel of the run
+ * @param src First source pixel of the run
+ * @param count Number of pixels in the run
+ * @param opacity Opacity the source gets scaled by, 0 - 15
+ */
+void premultiplied(u16* dst, const u16* src, u32 count, u16 opacity);
+
+}  // namespace tsl::gfx::blend
+
+#endif  // LIBNIKOLA_BLEND_HPP
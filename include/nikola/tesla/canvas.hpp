@@ -0,0 +1,108 @@
+//
+// Created by pugemon on 16.10.26.
+//
+
+#ifndef LIBNIKOLA_CANVAS_HPP
+#define LIBNIKOLA_CANVAS_HPP
+
+#include <vector>
+
+#include <switch.h>
+
+#include "gfx.hpp"
+#include "image.hpp"
+
+namespace tsl::gfx
+{
+
+/**
+ * @brief An offscreen render target every draw call of the renderer can draw
+ * into. What's drawn is kept until the canvas gets invalidated and costs a
+ * single image blit per frame to show
+ * @note Draw into it between \ref Renderer::beginCanvas and \ref
+ * Renderer::endCanvas, then show it with \ref Renderer::drawCanvas. Pixels
+ * blend exactly like on the layer, so text and other source blended calls
+ * keep the alpha of what's below them. Give the canvas the background it
+ * gets shown on to have it look the same as drawing there directly
+ */
+class Canvas final
+{
+public:
+  Canvas() {}
+
+  /**
+   * @brief Constructor
+   *
+   * @param width Width
+   * @param height Height
+   * @param background Color the canvas gets cleared to before drawing
+   */
+  Canvas(u16 width, u16 height, Color background = 0)
+  {
+    this->setBackground(background);
+    this->resize(width, height);
+  }
+
+  /**
+   * @brief Changes the size of the canvas and invalidates it
+   * @note Clamped to the size of the layer
+   *
+   * @param width Width
+   * @param height Height
+   */
+  void resize(u16 width, u16 height);
+
+  /**
+   * @brief Sets the color the canvas gets cleared to and invalidates it
+   * @note With a transparent background the canvas is blended over what's
+   * below it. Otherwise it's shown like an opaque image, its colors replace
+   * the area it's drawn to and the layer alpha there is kept
+   *
+   * @param background Background color
+   */
+  void setBackground(Color background);
+
+  /**
+   * @brief Gets the canvas width
+   *
+   * @return Width in pixels
+   */
+  u16 getWidth() const { return this->m_width; }
+
+  /**
+   * @brief Gets the canvas height
+   *
+   * @return Height in pixels
+   */
+  u16 getHeight() const { return this->m_height; }
+
+  /**
+   * @brief Checks if the canvas has been drawn since it was last invalidated
+   *
+   * @return Canvas is up to date
+   */
+  bool isValid() const { return this->m_valid; }
+
+  /**
+   * @brief Marks the canvas as outdated so its owner draws it again
+   */
+  void invalidate() { this->m_valid = false; }
+
+private:
+  friend class Renderer;
+
+  u16 m_width = 0, m_height = 0;
+  Color m_background = 0;
+  bool m_valid = false;
+
+  // Row major RGBA4444 pixels draw calls write to and the offset tables the
+  // renderer swaps in while the canvas is the render target
+  std::vector<u16> m_pixels;
+  std::vector<u32> m_rowOffsets, m_columnOffsets;
+
+  Image m_image;  ///< What gets shown, converted when drawing finishes
+};
+
+}  // namespace tsl::gfx
+
+#endif  // LIBNIKOLA_CANVAS_HPP
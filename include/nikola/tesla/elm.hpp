@@ -10,6 +10,7 @@
 
 #include <switch.h>
 
+#include "canvas.hpp"
 #include "focus_direction.hpp"
 #include "gfx.hpp"
 #include "../utils/ini_funcs.hpp"
@@ -197,9 +198,41 @@ public:
    */
   virtual void setFocused(bool focused);
 
+  /**
+   * @brief Checks if the element is focused
+   *
+   * @return Element is focused
+   */
+  virtual bool isFocused() final { return this->m_focused; }
+
+  /**
+   * @brief Marks the element's area as changed so it gets redrawn next frame
+   * @note Call this when something the element draws changes without going
+   * through one of the setters that already do so
+   */
+  virtual void markDirty() final;
+
+  /**
+   * @brief Hands the strings the element draws to \ref
+   * gfx::Renderer::prewarmGlyphs so their glyphs are ready when it gets drawn
+   * @note Called on the top element when a Gui gets created. Elements with
+   * children have to pass the call on to them
+   *
+   * @param renderer Renderer
+   */
+  virtual void prewarmGlyphs(gfx::Renderer* renderer) {}
+
 protected:
   constexpr static inline auto a = &gfx::Renderer::a;
 
+  /// Space around the element the highlight and its shake may draw into
+  static constexpr s32 HighlightMargin = 16;
+
+  /**
+   * @brief Marks the element's area and the highlight around it as changed
+   */
+  void markHighlightDirty();
+
 private:
   friend class Gui;
 
@@ -266,6 +299,8 @@ public:
   virtual Element* requestFocus(Element* oldFocus,
                                 FocusDirection direction) override;
 
+  virtual void prewarmGlyphs(gfx::Renderer* renderer) override;
+
   /**
    * @brief Sets the content of the frame
    *
@@ -349,6 +384,10 @@ public:
   virtual Element* requestFocus(Element* oldFocus,
                                 FocusDirection direction) override;
 
+  virtual void setFocused(bool focused) override;
+
+  virtual void prewarmGlyphs(gfx::Renderer* renderer) override;
+
   /**
    * @brief Sets the left hand description text of the list item
    *
@@ -369,7 +408,8 @@ protected:
   std::string m_value = "";
   bool m_faint = false;
 
-  u16 m_valueWidth = 0;
+  gfx::TextLayout m_textLayout, m_valueLayout;
+  gfx::ScrollingText m_scrollingText;  ///< Text while it's focused and cut off
 };
 
 /**
@@ -397,6 +437,8 @@ public:
 
   virtual bool onClick(u64 keys);
 
+  virtual void prewarmGlyphs(gfx::Renderer* renderer) override;
+
   /**
    * @brief Gets the current state of the toggle
    *
@@ -472,6 +514,8 @@ public:
   virtual Element* requestFocus(Element* oldFocus,
                                 FocusDirection direction) override;
 
+  virtual void prewarmGlyphs(gfx::Renderer* renderer) override;
+
 protected:
   struct ListEntry
   {
@@ -521,8 +565,26 @@ public:
   {
   }
 
+  /**
+   * @brief Draws the view into a canvas once and shows that every frame
+   * instead of calling the render callback each time
+   * @note The callback then draws relative to the canvas, at the x and y pos
+   * it gets passed. Call \ref redraw when what it draws changes
+   *
+   * @param cached Cache the view
+   */
+  virtual void setCached(bool cached);
+
+  /**
+   * @brief Calls the render callback again on the next frame
+   */
+  virtual void redraw();
+
 private:
   std::function<void(gfx::Renderer*, u16 x, u16 y, u16 w, u16 h)> m_renderFunc;
+
+  bool m_cached = false;
+  gfx::Canvas m_canvas;
 };
 
 }  // namespace tsl::elm
@@ -0,0 +1,135 @@
+//
+// Created by pugemon on 16.10.26.
+//
+
+#ifndef LIBNIKOLA_FONT_METRICS_HPP
+#define LIBNIKOLA_FONT_METRICS_HPP
+
+#include <array>
+#include <bitset>
+#include <unordered_map>
+
+#include <switch.h>
+
+#include "../stb_truetype.h"
+
+namespace tsl::gfx
+{
+
+/**
+ * @brief Cache of per codepoint font metrics
+ * @note Resolves which font a codepoint is drawn with, the extended font first
+ * and the standard font as a fallback, and keeps the unscaled advance and
+ * bounding box of the glyph so laying out text doesn't have to walk the font
+ * tables again. Latin-1 codepoints live in a flat table, everything else in a
+ * hash map
+ */
+class FontMetrics final
+{
+public:
+  /**
+   * @brief A font the metrics were resolved against
+   */
+  struct Font
+  {
+    stbtt_fontinfo* info;
+    u8 index;  ///< Position in the fallback order
+    s32 height;  ///< Unscaled distance from ascender to descender
+    s32 monospaceAdvance;  ///< Unscaled advance of 'W'
+
+    /**
+     * @brief Gets the scale producing text of the given height
+     * @note Same result as stbtt_ScaleForPixelHeight
+     *
+     * @param pixelHeight Height of the text in pixels
+     * @return Scale
+     */
+    float getScale(float pixelHeight) const
+    {
+      return pixelHeight / static_cast<float>(this->height);
+    }
+  };
+
+  /**
+   * @brief Metrics of a single codepoint
+   */
+  struct Glyph
+  {
+    const Font* font;  ///< Font the codepoint is drawn with
+    s32 index;  ///< Glyph index inside that font
+    s32 advance;  ///< Unscaled horizontal advance
+    s16 x0, y0, x1, y1;  ///< Unscaled bounding box, zero for empty glyphs
+
+    /**
+     * @brief Gets the pixel bounding box of the glyph
+     * @note Same result as stbtt_GetCodepointBitmapBox
+     *
+     * @param scale Font scale
+     * @param bounds Receives x0, y0, x1 and y1 relative to the glyph origin
+     */
+    void getBitmapBox(float scale, s32 (&bounds)[4]) const;
+  };
+
+  FontMetrics() {}
+
+  FontMetrics(const FontMetrics&) = delete;
+  FontMetrics& operator=(const FontMetrics&) = delete;
+
+  /**
+   * @brief Sets the fonts to resolve codepoints against and drops all cached
+   * metrics
+   *
+   * @param stdFont Standard font, used when the extended font lacks a glyph
+   * @param extFont Extended font, tried first
+   */
+  void setFonts(stbtt_fontinfo* stdFont, stbtt_fontinfo* extFont);
+
+  /**
+   * @brief Gets one of the fonts in fallback order
+   *
+   * @param index 0 for the extended font, 1 for the standard font
+   * @return Font
+   */
+  const Font& getFont(u8 index) const { return this->m_fonts[index]; }
+
+  /**
+   * @brief Looks up the metrics of a codepoint, resolving them on a miss
+   * @note The returned reference stays valid until the fonts are changed
+   *
+   * @param codepoint Unicode codepoint
+   * @return Glyph metrics
+   */
+  const Glyph& get(u32 codepoint);
+
+private:
+  static constexpr u32 FlatTableSize = 0x100;
+
+  // Extended font first, standard font as the fallback
+  std::array<Font, 2> m_fonts;
+
+  std::array<Glyph, FlatTableSize> m_flatGlyphs;
+  std::bitset<FlatTableSize> m_flatResolved;
+  std::unordered_map<u32, Glyph> m_glyphs;
+
+  /**
+   * @brief Resolves the metrics of a codepoint from the font tables
+   *
+   * @param codepoint Unicode codepoint
+   * @return Glyph metrics
+   */
+  Glyph resolve(u32 codepoint) const;
+};
+
+/**
+ * @brief Identifies a font by hashing its table directory, which holds the
+ * checksum, offset and length of every table
+ * @note tools/glyph_baker.cpp computes the same value for the fonts it bakes
+ *
+ * @param font STB Font
+ * @return FNV-1a hash of the table directory
+ */
+u32 fingerprintFont(const stbtt_fontinfo* font);
+
+}  // namespace tsl::gfx
+
+#endif  // LIBNIKOLA_FONT_METRICS_HPP
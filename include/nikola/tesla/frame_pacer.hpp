@@ -0,0 +1,136 @@
+//
+// Created by pugemon on 16.10.26.
+//
+
+#ifndef LIBNIKOLA_FRAME_PACER_HPP
+#define LIBNIKOLA_FRAME_PACER_HPP
+
+#include <functional>
+
+#include <switch.h>
+
+namespace tsl::gfx
+{
+
+/**
+ * @brief How frames are timed
+ */
+enum class PacingMode : u8
+{
+  VSync,  ///< Present on every n-th vsync, n chosen to match the frame rate
+  FixedInterval,  ///< Present on a fixed grid of deadlines, ignoring vsync
+  LowLatency,  ///< Start rendering as late as possible before the vsync
+};
+
+/**
+ * @brief Decides when a frame should start rendering and when it should be
+ * presented
+ * @note Only computes durations, the caller does the actual sleeping and
+ * vsync waiting. Time comes from a replaceable clock so the deadline logic
+ * can be driven by a fake one
+ */
+class FramePacer final
+{
+public:
+  /// Monotonic time in nanoseconds
+  using Clock = std::function<u64()>;
+
+  /// Display refresh period in nanoseconds
+  static constexpr u64 VSyncPeriod = 1'000'000'000 / 60;
+
+  /// Time left between the end of rendering and the vsync in low latency mode
+  static constexpr u64 LowLatencyMargin = 2'000'000;
+
+  /**
+   * @brief What to do between the end of rendering and presenting
+   */
+  struct Present
+  {
+    u64 sleep;  ///< Nanoseconds to sleep first
+    u32 vsyncs;  ///< Number of vsyncs to wait for afterwards
+  };
+
+  /**
+   * @brief Frame timing counters, times in nanoseconds
+   */
+  struct Stats
+  {
+    u64 frames = 0;  ///< Frames presented
+    u64 missedFrames = 0;  ///< Frames presented later than planned
+    u64 lastFrameTime = 0;  ///< Time between the last two presents
+    u64 averageFrameTime = 0;  ///< Moving average of the frame time
+    u64 jitter = 0;  ///< Moving average deviation from the average frame time
+    u64 averageRenderTime = 0;  ///< Moving average of the rendering time
+  };
+
+  /**
+   * @brief Constructor
+   *
+   * @param clock Monotonic clock, the system tick counter if empty, or the
+   * steady clock when built for another platform
+   */
+  FramePacer(Clock clock = {});
+
+  /**
+   * @brief Sets the pacing mode and frame rate. Restarts the timing when
+   * either changes
+   *
+   * @param mode Pacing mode
+   * @param fps Frames per second
+   */
+  void configure(PacingMode mode, u32 fps);
+
+  /**
+   * @brief Gets how long to wait before starting to render the next frame
+   *
+   * @return Nanoseconds to sleep, 0 outside of low latency mode
+   */
+  u64 getStartDelay() const;
+
+  /**
+   * @brief Called right before rendering starts
+   */
+  void onFrameStart();
+
+  /**
+   * @brief Called once rendering is done
+   *
+   * @return How to wait before presenting
+   */
+  Present onFrameEnd();
+
+  /**
+   * @brief Called right after the frame got presented
+   */
+  void onPresented();
+
+  /**
+   * @brief Gets the frame timing counters
+   *
+   * @return Counters
+   */
+  const Stats& getStats() const { return this->m_stats; }
+
+  /**
+   * @brief Resets the frame timing counters to zero
+   */
+  void resetStats() { this->m_stats = {}; }
+
+private:
+  Clock m_clock;
+
+  PacingMode m_mode = PacingMode::VSync;
+  u32 m_fps = 0;
+  u64 m_period = 0;  ///< Planned time between two presents
+  u32 m_vsyncInterval = 1;  ///< Vsyncs per frame
+
+  u64 m_frameStart = 0;
+  u64 m_lastPresent = 0;  ///< 0 until the first present after configuring
+  u64 m_deadline = 0;  ///< Next present in fixed interval mode
+
+  Stats m_stats;
+};
+
+}  // namespace tsl::gfx
+
+#endif  // LIBNIKOLA_FRAME_PACER_HPP
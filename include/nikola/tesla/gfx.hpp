@@ -5,11 +5,23 @@
 #ifndef LIBNIKOLA_GFX_HPP
 #define LIBNIKOLA_GFX_HPP
 
+#include <array>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include <switch.h>
 
 #include "../stb_truetype.h"
+#include "font_metrics.hpp"
+#include "frame_pacer.hpp"
+#include "glyph_cache.hpp"
+#include "glyph_prewarmer.hpp"
+#include "image.hpp"
+#include "scrolling_text.hpp"
+#include "sdf_glyph_cache.hpp"
+#include "text_layout.hpp"
+#include "worker_pool.hpp"
 
 namespace tsl
 {
@@ -54,6 +66,8 @@ struct Color
 
 Color RGB888(std::string hexColor, std::string defaultHexColor = "#FFFFFF");
 
+class Canvas;
+
 /**
  * @brief Manages the Tesla layer and draws raw data to the screen
  */
@@ -63,6 +77,7 @@ public:
   Renderer& operator=(Renderer&) = delete;
 
   friend class tsl::Overlay;
+  friend struct RendererTest;  ///< Drives frames in tests/renderer_test.cpp
 
   /**
    * @brief Handles opacity of drawn colors for fadeout. Pass all colors through
@@ -76,6 +91,8 @@ public:
   /**
    * @brief Enables scissoring, discarding of any draw outside the given
    * boundaries
+   * @note Pushes the boundaries onto the clip stack as they are, without
+   * intersecting them with the current clip rect
    *
    * @param x x pos
    * @param y y pos
@@ -86,9 +103,27 @@ public:
 
   /**
    * @brief Disables scissoring
+   * @note Pops the clip rect pushed by \ref enableScissoring
    */
   void disableScissoring();
 
+  /**
+   * @brief Restricts drawing to the intersection of a rectangle and the
+   * current clip rect until the matching \ref popClip
+   *
+   * @param x X pos
+   * @param y Y pos
+   * @param w Width
+   * @param h Height
+   */
+  void pushClip(s32 x, s32 y, s32 w, s32 h);
+
+  /**
+   * @brief Restores the clip rect from before the last \ref pushClip or
+   * \ref enableScissoring
+   */
+  void popClip();
+
   // Drawing functions
 
   /**
@@ -150,6 +185,63 @@ public:
    */
   void drawEmptyRect(s16 x, s16 y, s16 w, s16 h, Color color);
 
+  /**
+   * @brief Draws a filled rectangle with anti-aliased rounded corners
+   *
+   * @param x X pos
+   * @param y Y pos
+   * @param w Width
+   * @param h Height
+   * @param radius Corner radius, limited to half the width and height
+   * @param color Color
+   */
+  void drawRoundedRect(s16 x, s16 y, s16 w, s16 h, s16 radius, Color color);
+
+  /**
+   * @brief Draws a filled anti-aliased circle
+   *
+   * @param x X pos of the center, on the corner between pixels
+   * @param y Y pos of the center, on the corner between pixels
+   * @param radius Radius
+   * @param color Color
+   */
+  void drawCircle(s16 x, s16 y, s16 radius, Color color);
+
+  /**
+   * @brief Draws a anti-aliased part of a ring
+   *
+   * @param x X pos of the center, on the corner between pixels
+   * @param y Y pos of the center, on the corner between pixels
+   * @param radius Outer radius
+   * @param thickness Distance between the outer and inner radius
+   * @param startAngle Angle the arc starts at in degrees, 0 points right and
+   * angles grow clockwise
+   * @param endAngle Angle the arc ends at in degrees, a full ring if it's 360
+   * degrees past the start
+   * @param color Color
+   */
+  void drawArc(s16 x,
+               s16 y,
+               s16 radius,
+               s16 thickness,
+               s16 startAngle,
+               s16 endAngle,
+               Color color);
+
+  /**
+   * @brief Draws a rectangle filled with a linear gradient
+   *
+   * @param x X pos
+   * @param y Y pos
+   * @param w Width
+   * @param h Height
+   * @param from Color of the first row or column
+   * @param to Color of the last row or column
+   * @param vertical Blend from top to bottom instead of left to right
+   */
+  void drawGradientRect(
+      s16 x, s16 y, s16 w, s16 h, Color from, Color to, bool vertical);
+
   /**
    * @brief Draws a line
    *
@@ -162,13 +254,27 @@ public:
   void drawLine(s16 x0, s16 y0, s16 x1, s16 y1, Color color);
 
   /**
-   * @brief Draws a dashed line
+   * @brief Draws a anti-aliased line. The color gets blended over the
+   * existing pixels, which keep their alpha
+   *
+   * @param x0 Start X pos
+   * @param y0 Start Y pos
+   * @param x1 End X pos
+   * @param y1 End Y pos
+   * @param color Color
+   */
+  void drawAntiAliasedLine(s16 x0, s16 y0, s16 x1, s16 y1, Color color);
+
+  /**
+   * @brief Draws a dashed line. Dashes and the gaps between them are
+   * line_width pixels long along the longer axis, starting with a dash at the
+   * start point
    *
    * @param x0 Start X pos
    * @param y0 Start Y pos
    * @param x1 End X pos
    * @param y1 End Y pos
-   * @param line_width How long one line can be
+   * @param line_width How long one line can be, a solid line if 0 or less
    * @param color Color
    */
   void drawDashedLine(
@@ -185,6 +291,44 @@ public:
    */
   void drawBitmap(s16 x, s16 y, s16 w, s16 h, const u8* bmp);
 
+  /**
+   * @brief Draws a converted image. Opaque rows get copied, transparent ones
+   * skipped and only the rest gets blended
+   * @note The image has to stay alive until the frame ends
+   *
+   * @param x X start position
+   * @param y Y start position
+   * @param image Image
+   */
+  void drawImage(s16 x, s16 y, const Image& image);
+
+  /**
+   * @brief Makes a canvas the target of all draw calls until \ref endCanvas
+   * @note The canvas gets cleared to its background first. Coordinates are
+   * relative to its top left corner and the clip rect covers all of it.
+   * Canvases can't be nested
+   *
+   * @param canvas Canvas to draw into
+   */
+  void beginCanvas(Canvas& canvas);
+
+  /**
+   * @brief Switches draw calls back to the layer and marks the canvas as
+   * valid so it can be shown with \ref drawCanvas
+   */
+  void endCanvas();
+
+  /**
+   * @brief Shows the last drawn contents of a canvas
+   * @note Same cost as drawing an image of the canvas size. The canvas has to
+   * stay alive and can't be drawn into again until the frame ends
+   *
+   * @param x X pos
+   * @param y Y pos
+   * @param canvas Canvas
+   */
+  void drawCanvas(s16 x, s16 y, const Canvas& canvas);
+
   /**
    * @brief Fills the entire layer with a given color
    *
@@ -214,13 +358,185 @@ public:
    * the string's dimensions
    * @return Dimensions of drawn string
    */
-  std::pair<u32, u32> drawString(const char* string,
+  std::pair<u32, u32> drawString(std::string_view string,
                                  bool monospace,
                                  u32 x,
                                  u32 y,
                                  float fontSize,
                                  Color color);
 
+  /**
+   * @brief Calculates the dimensions of a string without drawing it
+   *
+   * @param string String to measure
+   * @param monospace Measure string in monospace font
+   * @param fontSize Height of the text in pixels
+   * @return Dimensions of the string
+   */
+  std::pair<u32, u32> measureString(std::string_view string,
+                                    bool monospace,
+                                    float fontSize);
+
+  /**
+   * @brief Decodes and positions a string once so it can be drawn repeatedly
+   * with \ref drawLayout
+   *
+   * @param layout Layout to fill, its previous contents are replaced
+   * @param string String to lay out
+   * @param monospace Lay string out in monospace font
+   * @param fontSize Height of the text in pixels
+   */
+  void layoutString(TextLayout& layout,
+                    std::string_view string,
+                    bool monospace,
+                    float fontSize);
+
+  /**
+   * @brief Breaks a string into lines that fit a paragraph style and
+   * positions them so they can be drawn repeatedly with \ref drawLayout
+   * @note Line breaks are only computed again when the layout was invalidated
+   * or the string, font size or style differ from last time, so this is cheap
+   * to call every frame
+   *
+   * @param layout Layout to fill
+   * @param string String to lay out, explicit line breaks are kept
+   * @param fontSize Height of the text in pixels
+   * @param style Width, wrapping, truncation and alignment of the lines
+   */
+  void layoutParagraph(TextLayout& layout,
+                       std::string_view string,
+                       float fontSize,
+                       const ParagraphStyle& style);
+
+  /**
+   * @brief Draws a string laid out by \ref layoutString or \ref
+   * layoutParagraph
+   *
+   * @param layout Layout to draw
+   * @param x X pos
+   * @param y Y pos
+   * @param color Text color
+   */
+  void drawLayout(const TextLayout& layout, s32 x, s32 y, Color color);
+
+  /**
+   * @brief Renders a single line of text into the coverage strip of a
+   * scrolling text
+   * @note Does nothing if the strip is valid and was rendered from the same
+   * string and font size, so this is cheap to call every frame
+   *
+   * @param text Scrolling text to fill
+   * @param string String to render
+   * @param fontSize Height of the text in pixels
+   */
+  void renderScrollingText(ScrollingText& text,
+                           std::string_view string,
+                           float fontSize);
+
+  /**
+   * @brief Draws the part of a scrolling text that's currently scrolled into
+   * view
+   *
+   * @param text Scrolling text
+   * @param x X pos of the view
+   * @param y Y pos of the baseline
+   * @param width Width of the view
+   * @param color Text color
+   */
+  void drawScrollingText(
+      const ScrollingText& text, s32 x, s32 y, u32 width, Color color);
+
+  /**
+   * @brief Rasterizes the glyphs of a string on a low priority thread, so
+   * drawing it later finds them in the glyph cache
+   * @note Cached glyphs are skipped. Finished glyphs get added to the cache
+   * when the next frame starts. Does nothing if the thread can't be started
+   *
+   * @param string UTF-8 string
+   * @param fontSize Height of the font the string will be drawn with
+   */
+  void prewarmGlyphs(std::string_view string, float fontSize);
+
+  /**
+   * @brief Gets the glyph cache counters
+   * @note Set \ref glyphCacheSize before the overlay starts to change how much
+   * memory the glyph cache may use
+   *
+   * @return Hits, misses and evictions since the start or the last reset
+   */
+  const GlyphCache::Stats& getGlyphCacheStats() const;
+
+  /**
+   * @brief Resets the glyph cache counters to zero
+   */
+  void resetGlyphCacheStats();
+
+  /**
+   * @brief Redraw counters
+   */
+  struct RedrawStats
+  {
+    u64 frames = 0;  ///< Frames started
+    u64 redrawnFrames = 0;  ///< Frames that had anything to redraw
+    u64 redrawnPixels = 0;  ///< Pixels inside the redrawn areas, all frames
+    u32 lastRedrawnPixels = 0;  ///< Pixels inside the last redrawn area
+    u64 copiedBlocks = 0;  ///< 32x16 blocks copied to the next framebuffer
+  };
+
+  /**
+   * @brief Marks an area as changed so it gets redrawn in the next frame
+   * @note While \ref partialRedraw is enabled, every draw call only touches
+   * the union of the areas marked since the previous frame started
+   *
+   * @param x X pos
+   * @param y Y pos
+   * @param w Width
+   * @param h Height
+   */
+  void addDamage(s32 x, s32 y, s32 w, s32 h);
+
+  /**
+   * @brief Marks the whole framebuffer as changed
+   */
+  void addFullDamage();
+
+  /**
+   * @brief Checks if any part of an area gets redrawn in the current frame
+   *
+   * @param x X pos
+   * @param y Y pos
+   * @param w Width
+   * @param h Height
+   * @return Area overlaps the redrawn area
+   */
+  bool isDamaged(s32 x, s32 y, s32 w, s32 h) const;
+
+  /**
+   * @brief Gets the redraw counters
+   *
+   * @return Frames and pixels redrawn since the start or the last reset
+   */
+  const RedrawStats& getRedrawStats() const;
+
+  /**
+   * @brief Resets the redraw counters to zero
+   */
+  void resetRedrawStats();
+
+  /**
+   * @brief Gets the frame timing counters
+   * @note Set \ref framePacing and \ref TeslaFPS to change how frames are
+   * timed
+   *
+   * @return Achieved frame time, jitter and missed frames
+   */
+  const FramePacer::Stats& getFrameStats() const;
+
+  /**
+   * @brief Resets the frame timing counters to zero
+   */
+  void resetFrameStats();
+
 private:
   Renderer() {}
 
@@ -251,10 +567,98 @@ private:
   Framebuffer m_framebuffer;
   void* m_currentFramebuffer = nullptr;
 
-  bool m_scissoring = false;
-  u16 m_scissorBounds[4];
+  // Clip rects as x0, y0, x1, y1 with exclusive right and bottom edges. The
+  // bottom one covers the whole framebuffer and never gets popped
+  std::vector<std::array<s32, 4>> m_clipStack;
+
+  // Areas marked for the next frame and the area redrawn in the current one,
+  // both as x0, y0, x1, y1 with exclusive right and bottom edges
+  s32 m_pendingDamage[4] = {0, 0, 0, 0};
+  s32 m_frameDamage[4] = {0, 0, 0, 0};
+  RedrawStats m_redrawStats;
+
+  // 32x16 pixel blocks written to this frame, one mask per row of blocks with
+  // a bit per block column. Only these get copied to the next framebuffer
+  std::vector<u64> m_dirtyBlocks;
+  u32 m_blockColumns = 0;
+
+  FramePacer m_framePacer;
+
+  // Canvas draw calls go to instead of the layer, if any, and the render
+  // target state it replaced until endCanvas restores it
+  Canvas* m_canvas = nullptr;
+  struct
+  {
+    bool linear, recording;
+    float opacity;
+    s32 frameDamage[4];
+    std::vector<std::array<s32, 4>> clipStack;
+  } m_canvasSaved;
+
+  /**
+   * @brief A draw call recorded for tiled rendering
+   */
+  struct DrawCommand
+  {
+    enum class Type : u8
+    {
+      Pixel,
+      PixelBlendSrc,
+      PixelBlendDst,
+      Rect,
+      RoundedRect,
+      Arc,
+      Gradient,
+      Line,
+      AntiAliasedLine,
+      DashedLine,
+      Bitmap,
+      Image,
+      Glyph,
+      Coverage,
+      Fill,
+    };
+
+    Type type;
+    Color color;
+    s32 args[6] = {};  ///< Positions and sizes as passed to the draw call
+    u32 data = 0;  ///< Copied data offset, image index or second gradient color
+    s32 clip[4] = {};  ///< Clip rect at the time of the call
+  };
+
+  // Tiles are whole multiples of the 32x16 swizzle blocks
+  static constexpr s32 TileWidth = 64, TileHeight = 64;
+
+  // While recording, draw calls are stored and binned into tiles instead of
+  // drawn, then the tiles get rasterized in parallel when the frame ends
+  bool m_recording = false;
+  std::vector<DrawCommand> m_commands;
+  std::vector<u8> m_commandData;
+  std::vector<const Image*> m_commandImages;
+  std::vector<std::vector<u32>> m_tileCommands;  ///< Commands touching a tile
+  std::vector<u32> m_activeTiles;
+  u32 m_tileColumns = 0;
+  WorkerPool m_workerPool;
+  u32 m_requestedWorkers = 0;  ///< Workers asked for, fewer may have started
+
+  // Offset tables of the render target, a pixel lives at m_rowOffsets[y] +
+  // m_columnOffsets[x]. Same as the swizzle tables unless rendering linearly
+  std::vector<u32> m_rowOffsets, m_columnOffsets;
+  std::vector<u32> m_swizzleRowOffsets, m_swizzleColumnOffsets;
+
+  // Row major back buffer used instead of the framebuffer when rendering
+  // linearly. Rows are padded to whole blocks so written blocks can be
+  // swizzled into the framebuffer without bounds checks
+  bool m_linear = false;
+  std::vector<u16> m_linearBuffer;
+  u32 m_linearStride = 0;
 
   stbtt_fontinfo m_stdFont, m_extFont;
+  FontMetrics m_fontMetrics;
+  std::vector<u32> m_codepoints;  ///< Decoded string, reused between calls
+  GlyphCache m_glyphCache;
+  SdfGlyphCache m_sdfGlyphCache;  ///< Glyph source while sdfText is set
+  GlyphPrewarmer m_glyphPrewarmer;
 
   static inline float s_opacity = 1.0F;
 
@@ -265,6 +669,21 @@ private:
    */
   void* getCurrentFramebuffer();
 
+  /**
+   * @brief Get the buffer draw calls write to, the current framebuffer or the
+   * linear back buffer
+   *
+   * @return Render target address
+   */
+  void* getRenderTarget();
+
+  /**
+   * @brief Get the render target size
+   *
+   * @return Render target size in bytes
+   */
+  size_t getRenderTargetSize();
+
   /**
    * @brief Get the next framebuffer address
    *
@@ -307,8 +726,7 @@ private:
   void waitForVSync();
 
   /**
-   * @brief Decodes a x and y coordinate into a offset into the swizzled
-   * framebuffer
+   * @brief Decodes a x and y coordinate into a offset into the render target
    *
    * @param x X pos
    * @param y Y Pos
@@ -316,6 +734,133 @@ private:
    */
   const u32 getPixelOffset(u32 x, u32 y);
 
+  /**
+   * @brief Decodes a x and y coordinate into a offset into the swizzled
+   * framebuffer without checking the scissor bounds
+   *
+   * @param x X pos
+   * @param y Y Pos
+   * @return Offset
+   */
+  u32 getBlockLinearOffset(u32 x, u32 y);
+
+  /**
+   * @brief Builds the per row and per column swizzle lookup tables for the
+   * current framebuffer size
+   *
+   */
+  void initSwizzleTables();
+
+  /**
+   * @brief Switches between drawing into the framebuffer and into the linear
+   * back buffer. Everything gets redrawn on the next frame
+   *
+   * @param linear Draw into the linear back buffer
+   */
+  void setLinearRendering(bool linear);
+
+  /**
+   * @brief Swizzles the blocks of the linear back buffer written to this
+   * frame into the current framebuffer
+   */
+  void swizzleDirtyBlocks();
+
+  /**
+   * @brief Clips a rectangle against the area redrawn this frame and the
+   * current clip rect
+   *
+   * @param[in,out] x0 Left edge, inclusive
+   * @param[in,out] y0 Top edge, inclusive
+   * @param[in,out] x1 Right edge, exclusive
+   * @param[in,out] y1 Bottom edge, exclusive
+   * @return false when nothing of the rectangle is left to draw
+   */
+  bool clipRect(s32& x0, s32& y0, s32& x1, s32& y1);
+
+  /**
+   * @brief Marks the blocks overlapping an already clipped rectangle as
+   * written to
+   *
+   * @param x0 Left edge, inclusive
+   * @param y0 Top edge, inclusive
+   * @param x1 Right edge, exclusive
+   * @param y1 Bottom edge, exclusive
+   */
+  void markBlocksDirty(s32 x0, s32 y0, s32 x1, s32 y1);
+
+  /**
+   * @brief Copies the blocks written to this frame into the next framebuffer
+   * so both hold the same image again
+   */
+  void copyDirtyBlocks();
+
+  /**
+   * @brief Checks if a pixel lies outside the area redrawn this frame, the
+   * current clip rect or the tile the calling thread rasterizes
+   *
+   * @param x X pos
+   * @param y Y pos
+   * @return Pixel must not be drawn
+   */
+  bool isOutsideFrame(s32 x, s32 y) const;
+
+  /**
+   * @brief Checks if draw calls get recorded instead of drawn right away
+   *
+   * @return Draw calls are recorded
+   */
+  bool isRecording() const;
+
+  /**
+   * @brief Stores a draw call and adds it to every tile it touches
+   *
+   * @param command Draw call, its clip gets filled in
+   * @param x0 Left edge of the area it may draw to, inclusive
+   * @param y0 Top edge of the area it may draw to, inclusive
+   * @param x1 Right edge of the area it may draw to, exclusive
+   * @param y1 Bottom edge of the area it may draw to, exclusive
+   * @return false when the call can't draw anything and was dropped
+   */
+  bool record(DrawCommand command, s32 x0, s32 y0, s32 x1, s32 y1);
+
+  /**
+   * @brief Replays a recorded draw call
+   *
+   * @param command Draw call
+   */
+  void execute(const DrawCommand& command);
+
+  /**
+   * @brief Rasterizes all recorded draw calls, one tile per job, and drops
+   * them
+   */
+  void rasterizeTiles();
+
+  /**
+   * @brief Destination blends a color onto every pixel of an already clipped
+   * rectangle, one contiguous 8 pixel run of the swizzled layout at a time
+   *
+   * @param x0 Left edge, inclusive
+   * @param y0 Top edge, inclusive
+   * @param x1 Right edge, exclusive
+   * @param y1 Bottom edge, exclusive
+   * @param color Color
+   */
+  void fillSpans(s32 x0, s32 y0, s32 x1, s32 y1, Color color);
+
+  /**
+   * @brief Blends a color onto an already clipped part of a row, weighted by
+   * a coverage value per pixel. Fully covered pixels get destination blended
+   * like \ref fillSpans, the rest source blended like text
+   *
+   * @param y Row
+   * @param x0 Left edge, inclusive
+   * @param x1 Right edge, exclusive
+   * @param coverage Coverage of every pixel in the range, 0 - 255
+   * @param color Color
+   */
+  void blendCoverage(s32 y, s32 x0, s32 x1, const u8* coverage, Color color);
+
   /**
    * @brief Initializes the renderer and layers
    *
@@ -335,6 +880,14 @@ private:
    */
   Result initFonts();
 
+  /**
+   * @brief Gets the key glyph cache files are saved with, derived from the
+   * shared fonts and the library version
+   *
+   * @return Key
+   */
+  u32 getGlyphCacheKey() const;
+
   /**
    * @brief Start a new frame
    * @warning Don't call this more than once before calling \ref endFrame
@@ -364,6 +917,31 @@ private:
                  stbtt_fontinfo* font,
                  float fontSize);
 
+  /**
+   * @brief Blends a rasterized glyph onto the screen
+   *
+   * @param glyph Glyph coverage
+   * @param x X pos
+   * @param y Y pos
+   * @param color Color
+   */
+  void blitGlyph(const GlyphCache::Glyph& glyph, s32 x, s32 y, Color color);
+
+  /**
+   * @brief Blends a single color onto the screen, scaled by a 4 bit coverage
+   * value per pixel
+   *
+   * @param x X pos
+   * @param y Y pos
+   * @param w Width
+   * @param h Height
+   * @param coverage Coverage, one value from 0 - 15 per byte
+   * @param stride Distance between the rows of the coverage
+   * @param color Color
+   */
+  void drawCoverage(
+      s32 x, s32 y, s32 w, s32 h, const u8* coverage, u32 stride, Color color);
+
   void setLayerPosImpl(u16 x, u16 y);
 };
 
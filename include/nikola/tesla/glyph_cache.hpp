@@ -0,0 +1,295 @@
+//
+// Created by pugemon on 16.10.26.
+//
+
+#ifndef LIBNIKOLA_GLYPH_CACHE_HPP
+#define LIBNIKOLA_GLYPH_CACHE_HPP
+
+#include <array>
+#include <list>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <switch.h>
+
+#include "../stb_truetype.h"
+
+namespace tsl::gfx
+{
+
+class SdfGlyphCache;
+
+/**
+ * @brief LRU cache of rasterized glyphs
+ * @note Glyphs are stored as 4 bit coverage, two pixels per byte with the left
+ * pixel in the low nibble, inside one fixed size atlas. The atlas is split
+ * into pages that get handed out to size classes on demand, so evicting a
+ * glyph always frees a slot another glyph of the same class can reuse
+ */
+class GlyphCache final
+{
+public:
+  /**
+   * @brief A rasterized glyph
+   */
+  struct Glyph
+  {
+    s16 xOffset, yOffset;  ///< Offset of the bitmap from the glyph origin
+    u16 width, height;  ///< Size of the bitmap in pixels
+    const u8* coverage;  ///< 4 bit coverage, (width + 1) / 2 bytes per row
+  };
+
+  /**
+   * @brief Cache counters
+   */
+  struct Stats
+  {
+    u64 hits = 0;  ///< Lookups served from the atlas
+    u64 misses = 0;  ///< Lookups that had to rasterize the glyph
+    u64 evictions = 0;  ///< Glyphs dropped to make room for others
+  };
+
+  static constexpr u32 PageSize = 0x1000;
+
+  GlyphCache() {}
+
+  GlyphCache(const GlyphCache&) = delete;
+  GlyphCache& operator=(const GlyphCache&) = delete;
+
+  /**
+   * @brief Sets the amount of memory the atlas may use and drops all cached
+   * glyphs
+   *
+   * @param bytes Atlas size in bytes, rounded down to whole pages
+   */
+  void setCapacity(size_t bytes);
+
+  /**
+   * @brief Gets the size of the atlas
+   *
+   * @return Atlas size in bytes
+   */
+  size_t getCapacity() const { return this->m_atlas.size(); }
+
+  /**
+   * @brief Sets where glyphs come from on a miss and drops all cached glyphs
+   *
+   * @param fields Distance fields to render glyphs from, nullptr to rasterize
+   * them directly
+   */
+  void setDistanceFields(SdfGlyphCache* fields);
+
+  /**
+   * @brief Gets the distance fields glyphs get rendered from
+   *
+   * @return Distance fields, nullptr if glyphs get rasterized directly
+   */
+  SdfGlyphCache* getDistanceFields() const { return this->m_distanceFields; }
+
+  /**
+   * @brief Adds a glyph rasterized ahead of time that is never evicted
+   * @note Pinned glyphs survive \ref clear and are only used while glyphs get
+   * rasterized directly, see \ref setDistanceFields
+   *
+   * @param font STB Font the glyph belongs to
+   * @param codepoint Unicode codepoint
+   * @param scale Font scale the glyph was rasterized at
+   * @param glyph Glyph, its coverage has to outlive the cache
+   */
+  void pin(const stbtt_fontinfo* font,
+           u32 codepoint,
+           float scale,
+           const Glyph& glyph);
+
+  /**
+   * @brief Looks up a glyph and rasterizes it on a miss
+   * @note The returned glyph stays valid until the next call
+   *
+   * @param font STB Font to use
+   * @param codepoint Unicode codepoint
+   * @param scale Font scale as returned by stbtt_ScaleForPixelHeight
+   * @return Glyph
+   */
+  const Glyph& get(const stbtt_fontinfo* font, u32 codepoint, float scale);
+
+  /**
+   * @brief Checks if a glyph is cached without counting as a lookup
+   *
+   * @param font STB Font to use
+   * @param codepoint Unicode codepoint
+   * @param scale Font scale
+   * @return Glyph is cached or pinned
+   */
+  bool contains(const stbtt_fontinfo* font, u32 codepoint, float scale) const;
+
+  /**
+   * @brief Adds a glyph rasterized elsewhere, e.g. on another thread
+   * @note Ignored if the glyph is already cached or glyphs get rendered from
+   * distance fields
+   *
+   * @param font STB Font the glyph belongs to
+   * @param codepoint Unicode codepoint
+   * @param scale Font scale the glyph was rasterized at
+   * @param glyph Glyph, its coverage gets copied
+   */
+  void insert(const stbtt_fontinfo* font,
+              u32 codepoint,
+              float scale,
+              const Glyph& glyph);
+
+  /**
+   * @brief Packs 8 bit coverage into the 4 bit layout glyphs are stored in
+   *
+   * @param bitmap 8 bit coverage, width bytes per row
+   * @param width Width in pixels
+   * @param height Height in pixels
+   * @param coverage Receives (width + 1) / 2 bytes per row
+   */
+  static void pack(const u8* bitmap, u16 width, u16 height, u8* coverage);
+
+  /**
+   * @brief Drops all cached glyphs
+   */
+  void clear();
+
+  /**
+   * @brief Writes all cached glyphs to a file so a later process can load
+   * them instead of rasterizing them again
+   * @note Glyphs rendered from distance fields aren't written
+   *
+   * @param path Path of the file
+   * @param fonts Fonts the glyphs may belong to, stored as their index
+   * @param key Identifies the fonts and the rasterizer, \ref load only accepts
+   * files written with the same key
+   * @return false if the file can't be written
+   */
+  bool save(const std::string& path,
+            std::span<const stbtt_fontinfo* const> fonts,
+            u32 key);
+
+  /**
+   * @brief Adds the glyphs of a file written by \ref save, read in one go
+   * @note Glyphs that don't fit into the atlas are dropped, least recently
+   * used first
+   *
+   * @param path Path of the file
+   * @param fonts Fonts in the same order they were saved with
+   * @param key Key the file has to be saved with
+   * @return false if the file can't be read or isn't valid, nothing is added
+   */
+  bool load(const std::string& path,
+            std::span<const stbtt_fontinfo* const> fonts,
+            u32 key);
+
+  /**
+   * @brief Checks if glyphs were rasterized since the cache was last cleared,
+   * saved or loaded
+   *
+   * @return Cache changed
+   */
+  bool isModified() const { return this->m_modified; }
+
+  /**
+   * @brief Gets the cache counters
+   *
+   * @return Counters
+   */
+  const Stats& getStats() const { return this->m_stats; }
+
+  /**
+   * @brief Resets the cache counters to zero
+   */
+  void resetStats() { this->m_stats = {}; }
+
+private:
+  struct Key
+  {
+    const stbtt_fontinfo* font;
+    u32 codepoint;
+    float scale;
+
+    bool operator==(const Key& other) const;
+  };
+
+  struct KeyHash
+  {
+    size_t operator()(const Key& key) const;
+  };
+
+  struct Entry
+  {
+    Key key;
+    Glyph glyph;
+    u32 slot;  ///< Offset into the atlas
+    u8 sizeClass;  ///< Slot size class, NoSizeClass for empty glyphs
+  };
+
+  static constexpr u32 MinSlotSize = 0x20;
+  static constexpr u8 SizeClassCount = 8;  // 32 bytes up to a whole page
+  static constexpr u8 NoSizeClass = 0xFF;
+
+  std::vector<u8> m_atlas;
+  std::vector<u16> m_pageUsage;  ///< Used slots per page
+  std::vector<u32> m_freePages;
+  std::array<std::vector<u32>, SizeClassCount> m_freeSlots;
+
+  // Most recently used glyph first
+  std::list<Entry> m_lru;
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_entries;
+  std::unordered_map<Key, Glyph, KeyHash> m_pinned;
+
+  SdfGlyphCache* m_distanceFields = nullptr;
+  bool m_modified = false;
+
+  // Rasterizer output and storage for glyphs too large for the atlas
+  std::vector<u8> m_bitmap;
+  std::vector<u8> m_uncached;
+  Glyph m_uncachedGlyph;
+
+  Stats m_stats;
+
+  /**
+   * @brief Copies a glyph into a free slot as the most recently used one
+   *
+   * @param key Key of the glyph
+   * @param glyph Glyph, its coverage has to fit into a page
+   * @return false if the atlas has no room at all
+   */
+  bool store(const Key& key, const Glyph& glyph);
+
+  /**
+   * @brief Gets the smallest size class a glyph fits into
+   *
+   * @param size Size of the glyph coverage in bytes, at most a page
+   * @return Size class
+   */
+  static u8 getSizeClass(u32 size);
+
+  /**
+   * @brief Gets a free slot of the given size class, evicting glyphs if needed
+   *
+   * @param sizeClass Size class
+   * @return Offset of the slot in the atlas
+   */
+  u32 allocateSlot(u8 sizeClass);
+
+  /**
+   * @brief Returns a slot to its size class and the page to the free pages once
+   * it is empty
+   *
+   * @param slot Offset of the slot in the atlas
+   * @param sizeClass Size class
+   */
+  void releaseSlot(u32 slot, u8 sizeClass);
+
+  /**
+   * @brief Evicts the least recently used glyph
+   */
+  void evict();
+};
+
+}  // namespace tsl::gfx
+
+#endif  // LIBNIKOLA_GLYPH_CACHE_HPP
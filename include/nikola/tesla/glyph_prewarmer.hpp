@@ -0,0 +1,116 @@
+//
+// Created by pugemon on 16.10.26.
+//
+
+#ifndef LIBNIKOLA_GLYPH_PREWARMER_HPP
+#define LIBNIKOLA_GLYPH_PREWARMER_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#if !defined(__SWITCH__)
+#  include <thread>
+#endif
+
+#include <switch.h>
+
+#include "../stb_truetype.h"
+#include "glyph_cache.hpp"
+
+namespace tsl::gfx
+{
+
+/**
+ * @brief Rasterizes glyphs on a low priority thread before they get drawn
+ * @note The glyph cache isn't touched from the worker. Finished glyphs wait
+ * until the render thread moves them into the cache with \ref collect
+ */
+class GlyphPrewarmer final
+{
+public:
+  /**
+   * @brief A glyph to rasterize
+   */
+  struct Request
+  {
+    const stbtt_fontinfo* font;
+    u32 codepoint;
+    float scale;
+
+    bool operator==(const Request& other) const;
+  };
+
+  GlyphPrewarmer() {}
+
+  GlyphPrewarmer(const GlyphPrewarmer&) = delete;
+  GlyphPrewarmer& operator=(const GlyphPrewarmer&) = delete;
+
+  ~GlyphPrewarmer() { this->stop(); }
+
+  /**
+   * @brief Starts the worker thread if it isn't running yet
+   *
+   * @return Whether the worker thread runs, false if it couldn't be started
+   */
+  bool start();
+
+  /**
+   * @brief Drops all requests and joins the worker thread
+   */
+  void stop();
+
+  /**
+   * @brief Queues a glyph, unless it's queued or rasterized already
+   * @note Does nothing while the worker thread isn't running
+   *
+   * @param request Glyph to rasterize
+   */
+  void schedule(const Request& request);
+
+  /**
+   * @brief Moves all rasterized glyphs into a glyph cache
+   *
+   * @param cache Cache to insert the glyphs into
+   */
+  void collect(GlyphCache& cache);
+
+private:
+  struct RequestHash
+  {
+    size_t operator()(const Request& request) const;
+  };
+
+  struct Result
+  {
+    Request request;
+    GlyphCache::Glyph glyph;
+    std::vector<u8> coverage;
+  };
+
+#if defined(__SWITCH__)
+  Thread m_thread;
+#else
+  std::thread m_thread;
+#endif
+  bool m_running = false;
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  bool m_stopping = false;
+
+  std::deque<Request> m_queue;
+  std::unordered_set<Request, RequestHash> m_scheduled;  ///< Not collected
+  std::vector<Result> m_results;
+
+  /**
+   * @brief Thread entry, rasterizes requests until the prewarmer stops
+   */
+  void workerMain();
+};
+
+}  // namespace tsl::gfx
+
+#endif  // LIBNIKOLA_GLYPH_PREWARMER_HPP
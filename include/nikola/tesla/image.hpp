@@ -0,0 +1,152 @@
+//
+// Created by pugemon on 16.10.26.
+//
+
+#ifndef LIBNIKOLA_IMAGE_HPP
+#define LIBNIKOLA_IMAGE_HPP
+
+#include <string>
+#include <vector>
+
+#include <switch.h>
+
+namespace tsl::gfx
+{
+
+/**
+ * @brief A bitmap converted once into premultiplied RGBA4444, ready to be
+ * drawn with \ref Renderer::drawImage every frame without any conversion
+ * @note Besides raw bitmaps, images load from the libnikola image format
+ * built by tools/nkimage.py. It starts with a 16 byte little endian header:
+ * the magic "NKIM", a u8 version (1), u8 flags, u16 width, u16 height, two
+ * reserved bytes and the u32 size of the pixel data that follows. The pixels
+ * are premultiplied RGBA4444, row by row, so no color channel exceeds the
+ * alpha. With flag bit 0 set they are run length encoded as packets starting
+ * with a u16: bit 15 set means the next pixel repeats (header & 0x7FFF) + 1
+ * times, clear means header + 1 pixels follow as they are
+ */
+class Image final
+{
+public:
+  /**
+   * @brief What a row of pixels needs to be drawn
+   */
+  enum class RowType : u8
+  {
+    Transparent,  ///< Every pixel has alpha 0, nothing to draw
+    Opaque,  ///< Every pixel has full alpha, drawn by copying
+    Translucent,  ///< Pixels need to be blended
+  };
+
+  Image() {}
+
+  /**
+   * @brief Constructor
+   *
+   * @param bmp Bitmap in the same layout \ref Renderer::drawBitmap takes
+   * @param width Bitmap width
+   * @param height Bitmap height
+   */
+  Image(const u8* bmp, u16 width, u16 height)
+  {
+    this->load(bmp, width, height);
+  }
+
+  /**
+   * @brief Replaces the image with a converted bitmap
+   *
+   * @param bmp Bitmap in the same layout \ref Renderer::drawBitmap takes
+   * @param width Bitmap width
+   * @param height Bitmap height
+   */
+  void load(const u8* bmp, u16 width, u16 height);
+
+  /**
+   * @brief Replaces the image with RGBA4444 pixels that aren't premultiplied
+   * yet, the way the renderer draws them
+   *
+   * @param pixels Pixels, row by row
+   * @param width Width
+   * @param height Height
+   */
+  void loadPixels(const u16* pixels, u16 width, u16 height);
+
+  /**
+   * @brief Replaces the image with one stored in the libnikola image format
+   *
+   * @param data File contents
+   * @param size Size of the file contents in bytes
+   * @return false if the data isn't a valid image, the image is left empty
+   */
+  bool loadMemory(const u8* data, size_t size);
+
+  /**
+   * @brief Replaces the image with a libnikola image file, read in one go
+   *
+   * @param path Path of the file, e.g. "sdmc:/switch/.overlays/icon.nki"
+   * @return false if the file can't be read or isn't a valid image, the image
+   * is left empty
+   */
+  bool loadFile(const std::string& path);
+
+  /**
+   * @brief Gets the image width
+   *
+   * @return Width in pixels
+   */
+  u16 getWidth() const { return this->m_width; }
+
+  /**
+   * @brief Gets the image height
+   *
+   * @return Height in pixels
+   */
+  u16 getHeight() const { return this->m_height; }
+
+  /**
+   * @brief Checks if every pixel of the image has full alpha
+   *
+   * @return Image is opaque
+   */
+  bool isOpaque() const { return this->m_opaque; }
+
+  /**
+   * @brief Gets a row of pixels
+   *
+   * @param y Row
+   * @return Premultiplied RGBA4444 pixels of the row
+   */
+  const u16* getRow(u16 y) const
+  {
+    return this->m_pixels.data() + y * this->m_width;
+  }
+
+  /**
+   * @brief Gets what a row of pixels needs to be drawn
+   *
+   * @param y Row
+   * @return Row type
+   */
+  RowType getRowType(u16 y) const { return this->m_rowTypes[y]; }
+
+private:
+  u16 m_width = 0, m_height = 0;
+  bool m_opaque = false;
+  std::vector<u16> m_pixels;
+  std::vector<RowType> m_rowTypes;
+
+  /**
+   * @brief Finds the row types and whether the image is opaque from the
+   * converted pixels
+   */
+  void classifyRows();
+
+  /**
+   * @brief Empties the image
+   */
+  void clear();
+};
+
+}  // namespace tsl::gfx
+
+#endif  // LIBNIKOLA_IMAGE_HPP
@@ -0,0 +1,88 @@
+//
+// Created by pugemon on 16.10.26.
+//
+
+#ifndef LIBNIKOLA_SCROLLING_TEXT_HPP
+#define LIBNIKOLA_SCROLLING_TEXT_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <switch.h>
+
+namespace tsl::gfx
+{
+
+class Renderer;
+
+/**
+ * @brief A single line of text rendered once into a coverage strip, so it can
+ * scroll like a marquee with one blit per frame instead of drawing every glyph
+ * @note Fill it with \ref Renderer::renderScrollingText and draw it with \ref
+ * Renderer::drawScrollingText. The strip is rendered again when the string or
+ * font size differ from last time, or after \ref invalidate
+ */
+class ScrollingText final
+{
+public:
+  static constexpr u32 Gap = 40;  ///< Pixels between the text and its repeat
+  static constexpr u32 Speed = 60;  ///< Pixels per second
+
+  /// Time the text rests at the start of every pass
+  static constexpr std::chrono::milliseconds Pause {1000};
+
+  ScrollingText() {}
+
+  /**
+   * @brief Checks if the strip has been rendered since it was last invalidated
+   *
+   * @return Strip is up to date
+   */
+  bool isValid() const { return this->m_valid; }
+
+  /**
+   * @brief Marks the strip as outdated so it gets rendered again
+   */
+  void invalidate() { this->m_valid = false; }
+
+  /**
+   * @brief Gets the width of the text, without its repeat
+   *
+   * @return Width in pixels
+   */
+  u32 getWidth() const { return this->m_width; }
+
+  /**
+   * @brief Scrolls back to the start of the text and pauses there
+   */
+  void restart();
+
+  /**
+   * @brief Gets how far the text has scrolled since \ref restart
+   *
+   * @return Offset into the strip in pixels
+   */
+  u32 getOffset() const;
+
+private:
+  friend class Renderer;
+
+  // 4 bit coverage, one value per byte. The text is in there twice, Gap
+  // pixels apart, so every offset can be drawn with a single window
+  std::vector<u8> m_coverage;
+  u32 m_width = 0, m_stride = 0, m_height = 0;
+  s32 m_left = 0, m_top = 0;  ///< Strip origin relative to the pen position
+
+  // What the strip was rendered from, it's kept until one of them changes
+  std::string m_text;
+  float m_fontSize = 0;
+  bool m_valid = false;
+
+  std::chrono::steady_clock::time_point m_start =
+      std::chrono::steady_clock::now();
+};
+
+}  // namespace tsl::gfx
+
+#endif  // LIBNIKOLA_SCROLLING_TEXT_HPP
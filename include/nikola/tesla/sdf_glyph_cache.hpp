@@ -0,0 +1,118 @@
+//
+// Created by pugemon on 16.10.26.
+//
+
+#ifndef LIBNIKOLA_SDF_GLYPH_CACHE_HPP
+#define LIBNIKOLA_SDF_GLYPH_CACHE_HPP
+
+#include <unordered_map>
+#include <vector>
+
+#include <switch.h>
+
+#include "../stb_truetype.h"
+#include "glyph_cache.hpp"
+
+namespace tsl::gfx
+{
+
+/**
+ * @brief Cache of glyphs stored as signed distance fields
+ * @note Every glyph is rasterized once at \ref BaseHeight and can then be
+ * rendered at any size by sampling the distance field, instead of running the
+ * rasterizer again for every size a glyph shows up in. \ref GlyphCache fills
+ * its misses from here once \ref GlyphCache::setDistanceFields is called.
+ * Distances are stored as bytes, \ref EdgeValue on the outline and growing by
+ * \ref DistanceScale per pixel towards the inside of the glyph
+ */
+class SdfGlyphCache final
+{
+public:
+  /**
+   * @brief A glyph rasterized as distance field
+   */
+  struct Glyph
+  {
+    s32 box[4];  ///< Glyph box in font units, x0, y0, x1, y1 with y up
+    s16 xOffset, yOffset;  ///< Offset of the field from the glyph origin
+    u16 width, height;  ///< Size of the field in pixels
+    float scale;  ///< Font scale the field was rasterized at
+    const u8* distance;  ///< One byte per pixel, nullptr for empty glyphs
+  };
+
+  static constexpr float BaseHeight = 48.0F;  ///< Pixel height of the fields
+  static constexpr u8 Padding = 4;  ///< Pixels around the outline
+  static constexpr u8 EdgeValue = 128;
+  static constexpr float DistanceScale = float(EdgeValue) / Padding;
+
+  SdfGlyphCache() {}
+
+  SdfGlyphCache(const SdfGlyphCache&) = delete;
+  SdfGlyphCache& operator=(const SdfGlyphCache&) = delete;
+
+  /**
+   * @brief Sets the amount of memory the fields may use and drops all cached
+   * glyphs
+   *
+   * @param bytes Size of all fields in bytes, the whole cache gets dropped
+   * once it grows past this
+   */
+  void setCapacity(size_t bytes);
+
+  /**
+   * @brief Looks up a glyph and rasterizes its distance field on a miss
+   * @note The returned glyph stays valid until the next call
+   *
+   * @param font STB Font to use
+   * @param codepoint Unicode codepoint
+   * @return Glyph
+   */
+  const Glyph& get(const stbtt_fontinfo* font, u32 codepoint);
+
+  /**
+   * @brief Renders a distance field into 8 bit coverage at a font scale
+   *
+   * @param glyph Glyph to render
+   * @param scale Font scale as returned by stbtt_ScaleForPixelHeight
+   * @param box Bitmap box stbtt_GetCodepointBitmapBox returns for the scale
+   * @param bitmap Coverage of box.width * box.height pixels
+   */
+  static void render(const Glyph& glyph,
+                     float scale,
+                     const GlyphCache::Glyph& box,
+                     u8* bitmap);
+
+  /**
+   * @brief Drops all cached glyphs
+   */
+  void clear();
+
+private:
+  struct Key
+  {
+    const stbtt_fontinfo* font;
+    u32 codepoint;
+
+    bool operator==(const Key& other) const = default;
+  };
+
+  struct KeyHash
+  {
+    size_t operator()(const Key& key) const;
+  };
+
+  struct Entry
+  {
+    Glyph glyph;
+    std::vector<u8> distance;
+  };
+
+  size_t m_capacity = 0;
+  size_t m_size = 0;  ///< Bytes used by all fields
+
+  std::unordered_map<Key, Entry, KeyHash> m_entries;
+};
+
+}  // namespace tsl::gfx
+
+#endif  // LIBNIKOLA_SDF_GLYPH_CACHE_HPP
@@ -0,0 +1,134 @@
+//
+// Created by pugemon on 16.10.26.
+//
+
+#ifndef LIBNIKOLA_TEXT_LAYOUT_HPP
+#define LIBNIKOLA_TEXT_LAYOUT_HPP
+
+#include <string>
+#include <vector>
+
+#include <switch.h>
+
+#include "../stb_truetype.h"
+
+namespace tsl::gfx
+{
+
+class Renderer;
+
+/**
+ * @brief Horizontal alignment of the lines of a paragraph
+ */
+enum class TextAlignment : u8
+{
+  Left,
+  Center,
+  Right,
+};
+
+/**
+ * @brief How \ref Renderer::layoutParagraph breaks a string into lines
+ */
+struct ParagraphStyle
+{
+  u32 maxWidth = 0;  ///< Width lines must fit into, 0 for no limit
+  u32 maxLines = 0;  ///< Lines past this many get cut off, 0 for no limit
+  bool wrap = true;  ///< Wrap lines that are too wide instead of cutting them
+  bool ellipsis = true;  ///< End cut off lines with an ellipsis
+  TextAlignment alignment = TextAlignment::Left;  ///< Within maxWidth if set
+
+  bool operator==(const ParagraphStyle& other) const = default;
+};
+
+/**
+ * @brief A string that has been decoded and laid out once and can be drawn
+ * any number of times without looking at the font again
+ * @note Fill it with \ref Renderer::layoutString or \ref
+ * Renderer::layoutParagraph and draw it with \ref Renderer::drawLayout. Call
+ * \ref invalidate when the text changes
+ */
+class TextLayout final
+{
+public:
+  /**
+   * @brief A positioned glyph
+   */
+  struct Glyph
+  {
+    u32 codepoint;
+    s32 x, y;  ///< Top left of the glyph bitmap relative to the layout origin
+    stbtt_fontinfo* font;  ///< Font the glyph is drawn with
+    float scale;  ///< Font scale
+  };
+
+  TextLayout() {}
+
+  /**
+   * @brief Checks if the layout has been filled since it was last invalidated
+   *
+   * @return Layout is up to date
+   */
+  bool isValid() const { return this->m_valid; }
+
+  /**
+   * @brief Marks the layout as outdated so it gets laid out again
+   */
+  void invalidate() { this->m_valid = false; }
+
+  /**
+   * @brief Gets the glyphs of the layout, whitespace is skipped
+   *
+   * @return Glyphs in drawing order
+   */
+  const std::vector<Glyph>& getGlyphs() const { return this->m_glyphs; }
+
+  /**
+   * @brief Gets the width of the laid out string
+   *
+   * @return Width in pixels, same as the one returned by \ref
+   * Renderer::drawString
+   */
+  u32 getWidth() const { return this->m_width; }
+
+  /**
+   * @brief Gets the height of the laid out string
+   *
+   * @return Height in pixels, same as the one returned by \ref
+   * Renderer::drawString
+   */
+  u32 getHeight() const { return this->m_height; }
+
+  /**
+   * @brief Gets the number of lines the string was laid out in
+   *
+   * @return Line count
+   */
+  u32 getLineCount() const { return this->m_lineCount; }
+
+  /**
+   * @brief Checks if text had to be cut off to fit the paragraph style
+   *
+   * @return Layout is missing some of the string
+   */
+  bool isTruncated() const { return this->m_truncated; }
+
+private:
+  friend class Renderer;
+
+  std::vector<Glyph> m_glyphs;
+  u32 m_width = 0, m_height = 0;
+  u32 m_lineCount = 0;
+  bool m_truncated = false;
+  bool m_valid = false;
+
+  // What a paragraph was laid out with, it's kept until one of them changes
+  bool m_paragraph = false;
+  std::string m_text;
+  float m_fontSize = 0;
+  ParagraphStyle m_style;
+};
+
+}  // namespace tsl::gfx
+
+#endif  // LIBNIKOLA_TEXT_LAYOUT_HPP
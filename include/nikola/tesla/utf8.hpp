@@ -0,0 +1,46 @@
+//
+// Created by pugemon on 16.10.26.
+//
+
+#ifndef LIBNIKOLA_UTF8_HPP
+#define LIBNIKOLA_UTF8_HPP
+
+#include <cwctype>
+#include <string_view>
+#include <vector>
+
+#include <switch.h>
+
+namespace tsl::gfx
+{
+
+/**
+ * @brief Decodes a whole UTF-8 string into codepoints in one pass
+ * @note Runs of ASCII are checked and widened without decoding 16 bytes at a
+ * time, with NEON or SSE2 where available. Decoding stops at the first
+ * malformed or truncated sequence, same as with decode_utf8
+ *
+ * @param string UTF-8 string, doesn't need to be null terminated
+ * @param codepoints Receives the codepoints, its previous contents are
+ * replaced. Reusing the buffer avoids allocating for every string
+ */
+void decodeUtf8(std::string_view string, std::vector<u32>& codepoints);
+
+/**
+ * @brief Checks if a codepoint is whitespace
+ * @note Same result as std::iswspace, without a library call for ASCII
+ *
+ * @param codepoint Unicode codepoint
+ * @return Codepoint is whitespace
+ */
+inline bool isSpace(u32 codepoint)
+{
+  if (codepoint < 0x80)
+    return codepoint == ' ' || (codepoint >= '\t' && codepoint <= '\r');
+
+  return std::iswspace(codepoint);
+}
+
+}  // namespace tsl::gfx
+
+#endif  // LIBNIKOLA_UTF8_HPP
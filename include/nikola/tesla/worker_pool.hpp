@@ -0,0 +1,100 @@
+//
+// Created by pugemon on 16.10.26.
+//
+
+#ifndef LIBNIKOLA_WORKER_POOL_HPP
+#define LIBNIKOLA_WORKER_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#if !defined(__SWITCH__)
+#  include <thread>
+#endif
+
+#include <switch.h>
+
+namespace tsl::gfx
+{
+
+/**
+ * @brief Small pool of threads that split indexed jobs between them
+ * @note Uses libnx threads on the console and std::thread everywhere else.
+ * The thread calling \ref run works on the job as well
+ */
+class WorkerPool final
+{
+public:
+  WorkerPool() {}
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  ~WorkerPool() { this->stop(); }
+
+  /**
+   * @brief Starts the worker threads, stopping any previous ones
+   * @note On the console every worker gets its own core while there are
+   * enough. Threads that can't be created are left out, \ref getThreadCount
+   * tells how many run
+   *
+   * @param threadCount Number of threads besides the calling one
+   */
+  void start(u32 threadCount);
+
+  /**
+   * @brief Stops and joins all worker threads
+   */
+  void stop();
+
+  /**
+   * @brief Gets the number of worker threads
+   *
+   * @return Threads besides the one calling \ref run
+   */
+  u32 getThreadCount() const { return this->m_threads.size(); }
+
+  /**
+   * @brief Calls a job once for every index and waits for all of them
+   * @note Indices are handed out in ascending order, but may finish in any
+   * order on any thread
+   *
+   * @param count Number of indices
+   * @param job Job called with every index in [0, count)
+   */
+  void run(u32 count, const std::function<void(u32)>& job);
+
+private:
+#if defined(__SWITCH__)
+  std::vector<Thread> m_threads;
+#else
+  std::vector<std::thread> m_threads;
+#endif
+
+  std::mutex m_mutex;
+  std::condition_variable m_wake, m_done;
+  bool m_stopping = false;
+  u64 m_generation = 0;  ///< Bumped for every job so workers notice it
+  u32 m_busy = 0;  ///< Workers that haven't finished the current job
+
+  const std::function<void(u32)>* m_job = nullptr;
+  u32 m_count = 0;
+  std::atomic<u32> m_next = 0;
+
+  /**
+   * @brief Thread entry, waits for jobs until the pool stops
+   */
+  void workerMain();
+
+  /**
+   * @brief Takes indices of the current job until none are left
+   */
+  void work();
+};
+
+}  // namespace tsl::gfx
+
+#endif  // LIBNIKOLA_WORKER_POOL_HPP
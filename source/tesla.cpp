@@ -162,11 +162,16 @@ void Overlay::loop()
 {
   auto& renderer = gfx::Renderer::get();
 
-  renderer.startFrame();
-
+  // Let animations and updates mark what changed before the frame decides
+  // what to redraw
   this->animationLoop();
   this->getCurrentGui()->update();
-  this->getCurrentGui()->draw(&renderer);
+
+  renderer.startFrame();
+
+  if (renderer.isDamaged(
+          0, 0, cfg::FramebufferWidth, cfg::FramebufferHeight))
+    this->getCurrentGui()->draw(&renderer);
 
   renderer.endFrame();
 }
@@ -220,9 +225,13 @@ void Overlay::clearScreen()
 {
   auto& renderer = gfx::Renderer::get();
 
+  renderer.addFullDamage();
   renderer.startFrame();
   renderer.clearScreen();
   renderer.endFrame();
+
+  // Whatever gets shown next has to be drawn from scratch
+  renderer.addFullDamage();
 }
 
 void Overlay::resetFlags()
@@ -241,7 +250,12 @@ std::unique_ptr<tsl::Gui>& Overlay::changeTo(std::unique_ptr<tsl::Gui>&& gui)
   gui->m_topElement = gui->createUI();
   gui->requestFocus(gui->m_topElement, FocusDirection::None);
 
+  // Rasterize the new text in idle time instead of when it gets drawn
+  if (gui->m_topElement != nullptr)
+    gui->m_topElement->prewarmGlyphs(&gfx::Renderer::get());
+
   this->m_guiStack.push(std::move(gui));
+  gfx::Renderer::get().addFullDamage();
 
   return this->m_guiStack.top();
 }
@@ -253,8 +267,10 @@ void Overlay::goBack()
     return;
   }
 
-  if (!this->m_guiStack.empty())
+  if (!this->m_guiStack.empty()) {
     this->m_guiStack.pop();
+    gfx::Renderer::get().addFullDamage();
+  }
 
   if (this->m_guiStack.empty())
     this->close();
@@ -0,0 +1,49 @@
+//
+// Created by pugemon on 16.10.26.
+//
+#include <iterator>
+#include <switch.h>
+
+#include "nikola/tesla/baked_glyphs.hpp"
+
+#if defined(NIKOLA_BAKED_GLYPHS)
+// Generated at build time, see cmake/bake-glyphs.cmake
+#  include "nikola/baked_glyph_atlas.hpp"
+#endif
+
+namespace tsl::gfx
+{
+
+u32 pinBakedGlyphs([[maybe_unused]] GlyphCache& cache,
+                   [[maybe_unused]] const FontMetrics& metrics)
+{
+#if defined(NIKOLA_BAKED_GLYPHS)
+  bool matches[std::size(baked::FontFingerprints)];
+  for (u8 i = 0; i < std::size(matches); i++)
+    matches[i] =
+        fingerprintFont(metrics.getFont(i).info) == baked::FontFingerprints[i];
+
+  u32 count = 0;
+  for (const BakedGlyph& glyph : baked::Glyphs) {
+    if (!matches[glyph.font])
+      continue;
+
+    const FontMetrics::Font& font = metrics.getFont(glyph.font);
+    cache.pin(font.info,
+              glyph.codepoint,
+              font.getScale(glyph.pixelHeight),
+              {glyph.xOffset,
+               glyph.yOffset,
+               glyph.width,
+               glyph.height,
+               baked::Coverage + glyph.offset});
+    count++;
+  }
+
+  return count;
+#else
+  return 0;
+#endif
+}
+
+}  // namespace tsl::gfx
@@ -0,0 +1,408 @@
+//
+// Created by pugemon on 16.10.26.
+//
+#include <algorithm>
+#include <switch.h>
+
+#include "nikola/tesla/blend.hpp"
+
+#if defined(__ARM_NEON)
+#  include <arm_neon.h>
+#elif defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+namespace tsl::gfx::blend
+{
+
+namespace
+{
+
+/**
+ * @brief Exact integer division by 15 for every value a 4 bit blend can
+ * produce (0 - 225)
+ */
+inline u16 div15(u16 x)
+{
+  return (x * 137) >> 11;
+}
+
+/**
+ * @brief Blends the color channels of a source over a destination pixel. This
+ * matches \ref Renderer::blendColor for every input
+ *
+ * @param dst Destination pixel
+ * @param r Red channel of the source
+ * @param g Green channel of the source
+ * @param b Blue channel of the source
+ * @param alpha Source alpha
+ * @return Blended color channels with the alpha bits cleared
+ */
+inline u16 blendChannels(u16 dst, u16 r, u16 g, u16 b, u16 alpha)
+{
+  const u16 oneMinusAlpha = 0xF - alpha;
+
+  return div15(r * alpha + (dst & 0xF) * oneMinusAlpha)
+      | div15(g * alpha + ((dst >> 4) & 0xF) * oneMinusAlpha) << 4
+      | div15(b * alpha + ((dst >> 8) & 0xF) * oneMinusAlpha) << 8;
+}
+
+#if defined(__ARM_NEON) || defined(__SSE2__)
+#  define NIKOLA_BLEND_VECTORIZED
+
+// Thin wrappers so the kernels below are written once for every instruction
+// set. A vector holds 8 RGBA4444 pixels or 8 16 bit intermediates
+
+constexpr u32 VectorWidth = 8;
+
+#  if defined(__ARM_NEON)
+
+using Vector = uint16x8_t;
+
+inline Vector load(const u16* p)
+{
+  return vld1q_u16(p);
+}
+
+inline Vector loadCoverage(const u8* p)
+{
+  return vmovl_u8(vld1_u8(p));
+}
+
+inline void store(u16* p, Vector v)
+{
+  vst1q_u16(p, v);
+}
+
+inline Vector splat(u16 x)
+{
+  return vdupq_n_u16(x);
+}
+
+inline Vector bitAnd(Vector a, Vector b)
+{
+  return vandq_u16(a, b);
+}
+
+inline Vector bitOr(Vector a, Vector b)
+{
+  return vorrq_u16(a, b);
+}
+
+inline Vector add(Vector a, Vector b)
+{
+  return vaddq_u16(a, b);
+}
+
+inline Vector sub(Vector a, Vector b)
+{
+  return vsubq_u16(a, b);
+}
+
+inline Vector mul(Vector a, Vector b)
+{
+  return vmulq_u16(a, b);
+}
+
+template<int N>
+inline Vector shr(Vector v)
+{
+  return vshrq_n_u16(v, N);
+}
+
+template<int N>
+inline Vector shl(Vector v)
+{
+  return vshlq_n_u16(v, N);
+}
+
+#  else
+
+using Vector = __m128i;
+
+inline Vector load(const u16* p)
+{
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+inline Vector loadCoverage(const u8* p)
+{
+  return _mm_unpacklo_epi8(
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)),
+      _mm_setzero_si128());
+}
+
+inline void store(u16* p, Vector v)
+{
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+}
+
+inline Vector splat(u16 x)
+{
+  return _mm_set1_epi16(static_cast<short>(x));
+}
+
+inline Vector bitAnd(Vector a, Vector b)
+{
+  return _mm_and_si128(a, b);
+}
+
+inline Vector bitOr(Vector a, Vector b)
+{
+  return _mm_or_si128(a, b);
+}
+
+inline Vector add(Vector a, Vector b)
+{
+  return _mm_add_epi16(a, b);
+}
+
+inline Vector sub(Vector a, Vector b)
+{
+  return _mm_sub_epi16(a, b);
+}
+
+inline Vector mul(Vector a, Vector b)
+{
+  return _mm_mullo_epi16(a, b);
+}
+
+template<int N>
+inline Vector shr(Vector v)
+{
+  return _mm_srli_epi16(v, N);
+}
+
+template<int N>
+inline Vector shl(Vector v)
+{
+  return _mm_slli_epi16(v, N);
+}
+
+#  endif
+
+inline Vector div15(Vector x)
+{
+  return shr<11>(mul(x, splat(137)));
+}
+
+/**
+ * @brief Vector version of \ref blendChannels with a alpha per lane
+ */
+inline Vector blendChannels(
+    Vector dst, Vector r, Vector g, Vector b, Vector alpha)
+{
+  const Vector nibble = splat(0xF);
+  const Vector oneMinusAlpha = sub(nibble, alpha);
+
+  const Vector red =
+      div15(add(mul(r, alpha), mul(bitAnd(dst, nibble), oneMinusAlpha)));
+  const Vector green = div15(
+      add(mul(g, alpha), mul(bitAnd(shr<4>(dst), nibble), oneMinusAlpha)));
+  const Vector blue = div15(
+      add(mul(b, alpha), mul(bitAnd(shr<8>(dst), nibble), oneMinusAlpha)));
+
+  return bitOr(red, bitOr(shl<4>(green), shl<8>(blue)));
+}
+
+#endif
+
+}  // namespace
+
+void fill(u16* dst, u32 count, Color color)
+{
+  if (color.a == 0xF) {
+    std::fill_n(dst, count, color.rgba);
+    return;
+  }
+
+  const u16 alphaBits = color.rgba & 0xF000;
+  u32 i = 0;
+
+#ifdef NIKOLA_BLEND_VECTORIZED
+  const Vector nibble = splat(0xF);
+  const Vector oneMinusAlpha = splat(0xF - color.a);
+  const Vector red = splat(color.r * color.a);
+  const Vector green = splat(color.g * color.a);
+  const Vector blue = splat(color.b * color.a);
+  const Vector alpha = splat(alphaBits);
+
+  for (; i + VectorWidth <= count; i += VectorWidth) {
+    const Vector pixels = load(dst + i);
+
+    const Vector r =
+        div15(add(red, mul(bitAnd(pixels, nibble), oneMinusAlpha)));
+    const Vector g =
+        div15(add(green, mul(bitAnd(shr<4>(pixels), nibble), oneMinusAlpha)));
+    const Vector b =
+        div15(add(blue, mul(bitAnd(shr<8>(pixels), nibble), oneMinusAlpha)));
+
+    store(dst + i, bitOr(bitOr(r, shl<4>(g)), bitOr(shl<8>(b), alpha)));
+  }
+#endif
+
+  for (; i < count; i++)
+    dst[i] = blendChannels(dst[i], color.r, color.g, color.b, color.a)
+        | alphaBits;
+}
+
+void span(u16* dst, const u16* src, u32 count)
+{
+  u32 i = 0;
+
+#ifdef NIKOLA_BLEND_VECTORIZED
+  const Vector nibble = splat(0xF);
+  const Vector alphaMask = splat(0xF000);
+
+  for (; i + VectorWidth <= count; i += VectorWidth) {
+    const Vector pixels = load(dst + i);
+    const Vector source = load(src + i);
+
+    store(dst + i,
+          bitOr(blendChannels(pixels,
+                              bitAnd(source, nibble),
+                              bitAnd(shr<4>(source), nibble),
+                              bitAnd(shr<8>(source), nibble),
+                              shr<12>(source)),
+                bitAnd(pixels, alphaMask)));
+  }
+#endif
+
+  for (; i < count; i++) {
+    const u16 source = src[i];
+
+    dst[i] = blendChannels(dst[i],
+                           source & 0xF,
+                           (source >> 4) & 0xF,
+                           (source >> 8) & 0xF,
+                           source >> 12)
+        | (dst[i] & 0xF000);
+  }
+}
+
+void mask(u16* dst, const u8* coverage, u32 count, Color color)
+{
+  u32 i = 0;
+
+#ifdef NIKOLA_BLEND_VECTORIZED
+  const Vector red = splat(color.r);
+  const Vector green = splat(color.g);
+  const Vector blue = splat(color.b);
+  const Vector colorAlpha = splat(color.a);
+  const Vector alphaMask = splat(0xF000);
+
+  for (; i + VectorWidth <= count; i += VectorWidth) {
+    const Vector pixels = load(dst + i);
+    const Vector alpha =
+        div15(mul(shr<4>(loadCoverage(coverage + i)), colorAlpha));
+
+    store(dst + i,
+          bitOr(blendChannels(pixels, red, green, blue, alpha),
+                bitAnd(pixels, alphaMask)));
+  }
+#endif
+
+  for (; i < count; i++) {
+    const u16 alpha = div15((coverage[i] >> 4) * color.a);
+
+    dst[i] = blendChannels(dst[i], color.r, color.g, color.b, alpha)
+        | (dst[i] & 0xF000);
+  }
+}
+
+void CoverageTable::build(Color color)
+{
+  this->color = color;
+
+  for (u16 coverage = 0; coverage < 16; coverage++) {
+    const u16 alpha = div15(coverage * color.a);
+    const u16 oneMinusAlpha = 0xF - alpha;
+
+    for (u16 dst = 0; dst < 16; dst++) {
+      const u16 i = coverage << 4 | dst;
+      this->red[i] = div15(color.r * alpha + dst * oneMinusAlpha);
+      this->green[i] = div15(color.g * alpha + dst * oneMinusAlpha) << 4;
+      this->blue[i] = div15(color.b * alpha + dst * oneMinusAlpha) << 8;
+    }
+  }
+}
+
+void coverage(u16* dst,
+              const u8* coverage,
+              u32 count,
+              const CoverageTable& table)
+{
+  for (u32 i = 0; i < count; i++) {
+    const u16 pixel = dst[i];
+    const u16 row = coverage[i] << 4;
+
+    dst[i] = table.red[row | (pixel & 0xF)]
+        | table.green[row | ((pixel >> 4) & 0xF)]
+        | table.blue[row | ((pixel >> 8) & 0xF)] | (pixel & 0xF000);
+  }
+}
+
+void copy(u16* dst, const u16* src, u32 count)
+{
+  u32 i = 0;
+
+#ifdef NIKOLA_BLEND_VECTORIZED
+  const Vector colorMask = splat(0x0FFF);
+  const Vector alphaMask = splat(0xF000);
+
+  for (; i + VectorWidth <= count; i += VectorWidth)
+    store(dst + i,
+          bitOr(bitAnd(load(src + i), colorMask),
+                bitAnd(load(dst + i), alphaMask)));
+#endif
+
+  for (; i < count; i++)
+    dst[i] = (src[i] & 0x0FFF) | (dst[i] & 0xF000);
+}
+
+void premultiplied(u16* dst, const u16* src, u32 count, u16 opacity)
+{
+  u32 i = 0;
+
+#ifdef NIKOLA_BLEND_VECTORIZED
+  const Vector nibble = splat(0xF);
+  const Vector scale = splat(opacity);
+  const Vector alphaMask = splat(0xF000);
+
+  for (; i + VectorWidth <= count; i += VectorWidth) {
+    const Vector pixels = load(dst + i);
+    const Vector source = load(src + i);
+    const Vector oneMinusAlpha =
+        sub(nibble, div15(mul(shr<12>(source), scale)));
+
+    const Vector r = add(div15(mul(bitAnd(source, nibble), scale)),
+                         div15(mul(bitAnd(pixels, nibble), oneMinusAlpha)));
+    const Vector g =
+        add(div15(mul(bitAnd(shr<4>(source), nibble), scale)),
+            div15(mul(bitAnd(shr<4>(pixels), nibble), oneMinusAlpha)));
+    const Vector b =
+        add(div15(mul(bitAnd(shr<8>(source), nibble), scale)),
+            div15(mul(bitAnd(shr<8>(pixels), nibble), oneMinusAlpha)));
+
+    store(dst + i,
+          bitOr(bitOr(r, shl<4>(g)),
+                bitOr(shl<8>(b), bitAnd(pixels, alphaMask))));
+  }
+#endif
+
+  for (; i < count; i++) {
+    const u16 source = src[i], pixel = dst[i];
+    const u16 oneMinusAlpha = 0xF - div15((source >> 12) * opacity);
+
+    // Premultiplied channels never exceed the alpha, so the sums stay in range
+    const auto channel = [&](u32 shift) -> u16
+    {
+      return div15(((source >> shift) & 0xF) * opacity)
+          + div15(((pixel >> shift) & 0xF) * oneMinusAlpha);
+    };
+
+    dst[i] = channel(0) | channel(4) << 4 | channel(8) << 8 | (pixel & 0xF000);
+  }
+}
+
+}  // namespace tsl::gfx::blend
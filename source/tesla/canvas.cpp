@@ -0,0 +1,44 @@
+//
+// Created by pugemon on 16.10.26.
+//
+#include <algorithm>
+#include <switch.h>
+
+#include "nikola/tesla/canvas.hpp"
+
+#include "nikola/tesla/cfg.hpp"
+
+namespace tsl::gfx
+{
+
+void Canvas::resize(u16 width, u16 height)
+{
+  // Draw calls stage rows in buffers sized for the layer
+  width = std::min<u16>(width, cfg::LayerMaxWidth);
+  height = std::min<u16>(height, cfg::LayerMaxHeight);
+
+  this->m_valid = false;
+
+  if (width == this->m_width && height == this->m_height)
+    return;
+
+  this->m_width = width;
+  this->m_height = height;
+  this->m_pixels.assign(width * height, 0);
+
+  this->m_rowOffsets.resize(height);
+  for (u32 y = 0; y < height; y++)
+    this->m_rowOffsets[y] = y * width;
+
+  this->m_columnOffsets.resize(width);
+  for (u32 x = 0; x < width; x++)
+    this->m_columnOffsets[x] = x;
+}
+
+void Canvas::setBackground(Color background)
+{
+  this->m_background = background;
+  this->m_valid = false;
+}
+
+}  // namespace tsl::gfx
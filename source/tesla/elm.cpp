@@ -2,6 +2,7 @@
 // Created by pugemon on 29.08.24.
 //
 
+#include <algorithm>
 #include <cmath>
 #include <switch.h>
 #include "nikola/tesla/elm.hpp"
@@ -30,6 +31,18 @@ bool Element::onTouch(u32 x, u32 y)
 
 void Element::frame(gfx::Renderer* renderer)
 {
+  const s32 x = this->m_x - HighlightMargin;
+  const s32 y = this->m_y - HighlightMargin;
+  const s32 width = this->m_width + 2 * HighlightMargin;
+  const s32 height = this->m_height + 2 * HighlightMargin;
+
+  // The highlight pulses, keep redrawing it for as long as it's shown
+  if (this->m_focused)
+    renderer->addDamage(x, y, width, height);
+
+  if (!renderer->isDamaged(x, y, width, height))
+    return;
+
   if (this->m_focused)
     this->drawHighlight(renderer);
 
@@ -134,10 +147,19 @@ void Element::drawHighlight(gfx::Renderer* renderer)
 
 void Element::setBoundaries(u16 x, u16 y, u16 width, u16 height)
 {
+  if (x == this->m_x && y == this->m_y && width == this->m_width
+      && height == this->m_height)
+    return;
+
+  // Both the area the element leaves and the one it moves to change
+  this->markHighlightDirty();
+
   this->m_x = x;
   this->m_y = y;
   this->m_width = width;
   this->m_height = height;
+
+  this->markHighlightDirty();
 }
 
 void Element::setClickListener(std::function<bool(u64)> clickListener)
@@ -157,9 +179,26 @@ Element* Element::getParent()
 
 void Element::setFocused(bool focused)
 {
+  if (focused != this->m_focused)
+    this->markHighlightDirty();
+
   this->m_focused = focused;
 }
 
+void Element::markDirty()
+{
+  gfx::Renderer::getRenderer().addDamage(
+      this->m_x, this->m_y, this->m_width, this->m_height);
+}
+
+void Element::markHighlightDirty()
+{
+  gfx::Renderer::getRenderer().addDamage(this->m_x - HighlightMargin,
+                                         this->m_y - HighlightMargin,
+                                         this->m_width + 2 * HighlightMargin,
+                                         this->m_height + 2 * HighlightMargin);
+}
+
 int Element::shakeAnimation(std::chrono::system_clock::duration t, float a)
 {
   float w = 0.2F;
@@ -180,10 +219,9 @@ void OverlayFrame::draw(gfx::Renderer* renderer)
 {
   renderer->fillScreen(a({0x0, 0x0, 0x0, alphabackground}));
 
+  renderer->drawString(this->m_title, false, 20, 50, 30, a(defaultTextColor));
   renderer->drawString(
-      this->m_title.c_str(), false, 20, 50, 30, a(defaultTextColor));
-  renderer->drawString(
-      this->m_subtitle.c_str(), false, 20, 70, 15, a(defaultTextColor));
+      this->m_subtitle, false, 20, 70, 15, a(defaultTextColor));
 
   if (FullMode == true)
     renderer->drawRect(
@@ -221,10 +259,23 @@ Element* OverlayFrame::requestFocus(Element* oldFocus, FocusDirection direction)
     return nullptr;
 }
 
-void OverlayFrame::setContent(Element* content)
+void OverlayFrame::prewarmGlyphs(gfx::Renderer* renderer)
 {
+  renderer->prewarmGlyphs(this->m_title, 30);
+  renderer->prewarmGlyphs(this->m_subtitle, 15);
+  if (!deactivateOriginalFooter)
+    renderer->prewarmGlyphs("\uE0E1  Back     \uE0E0  OK", 23);
+
   if (this->m_contentElement != nullptr)
+    this->m_contentElement->prewarmGlyphs(renderer);
+}
+
+void OverlayFrame::setContent(Element* content)
+{
+  if (this->m_contentElement != nullptr) {
     delete this->m_contentElement;
+    this->markDirty();
+  }
 
   this->m_contentElement = content;
 
@@ -245,16 +296,19 @@ void DebugRectangle::draw(gfx::Renderer* renderer)
 
 void ListItem::draw(gfx::Renderer* renderer)
 {
-  if (this->m_valueWidth == 0) {
-    auto [width, height] =
-        renderer->drawString(this->m_value.c_str(),
-                             false,
-                             0,
-                             0,
-                             20,
-                             tsl::style::color::ColorTransparent);
-    this->m_valueWidth = width;
-  }
+  if (!this->m_valueLayout.isValid())
+    renderer->layoutString(this->m_valueLayout, this->m_value, false, 20);
+
+  // The text gets cut off where it would run into the value
+  const u32 valueWidth = this->m_valueLayout.getWidth();
+  const s32 textWidth =
+      this->getWidth() - 40 - (valueWidth > 0 ? valueWidth + 20 : 0);
+
+  renderer->layoutParagraph(
+      this->m_textLayout,
+      this->m_text,
+      23,
+      {.maxWidth = static_cast<u32>(std::max(textWidth, 0)), .wrap = false});
 
   renderer->drawRect(
       this->getX(), this->getY(), this->getWidth(), 1, a({0x4, 0x4, 0x4, 0xF}));
@@ -264,19 +318,24 @@ void ListItem::draw(gfx::Renderer* renderer)
                      1,
                      a({0x0, 0x0, 0x0, 0xD}));
 
-  renderer->drawString(this->m_text.c_str(),
-                       false,
-                       this->getX() + 20,
-                       this->getY() + 45,
-                       23,
-                       a(defaultTextColor));
-
-  renderer->drawString(
-      this->m_value.c_str(),
-      false,
-      this->getX() + this->getWidth() - this->m_valueWidth - 20,
+  // Cut off text scrolls through its space instead while focused
+  if (this->isFocused() && this->m_textLayout.isTruncated()) {
+    renderer->renderScrollingText(this->m_scrollingText, this->m_text, 23);
+    renderer->drawScrollingText(this->m_scrollingText,
+                                this->getX() + 20,
+                                this->getY() + 45,
+                                std::max(textWidth, 0),
+                                a(defaultTextColor));
+  } else
+    renderer->drawLayout(this->m_textLayout,
+                         this->getX() + 20,
+                         this->getY() + 45,
+                         a(defaultTextColor));
+
+  renderer->drawLayout(
+      this->m_valueLayout,
+      this->getX() + this->getWidth() - this->m_valueLayout.getWidth() - 20,
       this->getY() + 45,
-      20,
       this->m_faint ? a({0x6, 0x6, 0x6, 0xF}) : a({0x5, 0xC, 0xA, 0xF}));
 }
 
@@ -285,16 +344,34 @@ Element* ListItem::requestFocus(Element* oldFocus, FocusDirection direction)
   return this;
 }
 
+void ListItem::setFocused(bool focused)
+{
+  if (focused && !this->isFocused())
+    this->m_scrollingText.restart();
+
+  Element::setFocused(focused);
+}
+
+void ListItem::prewarmGlyphs(gfx::Renderer* renderer)
+{
+  renderer->prewarmGlyphs(this->m_text, 23);
+  renderer->prewarmGlyphs(this->m_value, 20);
+}
+
 void ListItem::setText(std::string text)
 {
   this->m_text = text;
+  this->m_textLayout.invalidate();
+  this->m_scrollingText.invalidate();
+  this->markDirty();
 }
 
 void ListItem::setValue(std::string value, bool faint)
 {
   this->m_value = value;
   this->m_faint = faint;
-  this->m_valueWidth = 0;
+  this->m_valueLayout.invalidate();
+  this->markDirty();
 }
 
 ToggleListItem::ToggleListItem(std::string text,
@@ -323,6 +400,14 @@ bool ToggleListItem::onClick(u64 keys)
   return false;
 }
 
+void ToggleListItem::prewarmGlyphs(gfx::Renderer* renderer)
+{
+  // The value not shown yet appears as soon as the toggle gets flipped
+  ListItem::prewarmGlyphs(renderer);
+  renderer->prewarmGlyphs(this->m_state ? this->m_offValue : this->m_onValue,
+                          20);
+}
+
 bool ToggleListItem::getState()
 {
   return this->m_state;
@@ -352,6 +437,12 @@ List::~List()
 
 void List::draw(gfx::Renderer* renderer)
 {
+  // Leave room for the highlight of the items at the edges
+  renderer->pushClip(this->getX() - HighlightMargin,
+                     this->getY() - HighlightMargin,
+                     this->getWidth() + 2 * HighlightMargin,
+                     this->getHeight() + 2 * HighlightMargin);
+
   u16 i = 0;
   for (auto& entry : this->m_items) {
     if (i >= this->m_offset && i < this->m_offset + this->m_entriesShown) {
@@ -359,6 +450,8 @@ void List::draw(gfx::Renderer* renderer)
     }
     i++;
   }
+
+  renderer->popClip();
 }
 
 void List::layout(u16 parentX, u16 parentY, u16 parentWidth, u16 parentHeight)
@@ -398,6 +491,8 @@ void List::clear()
   for (auto& item : this->m_items)
     delete item.element;
 
+  this->markHighlightDirty();
+
   this->m_items.clear();
 }
 
@@ -445,6 +540,12 @@ Element* List::requestFocus(Element* oldFocus, FocusDirection direction)
   return it->element;
 }
 
+void List::prewarmGlyphs(gfx::Renderer* renderer)
+{
+  for (auto& item : this->m_items)
+    item.element->prewarmGlyphs(renderer);
+}
+
 bool List::ListEntry::operator==(Element* other)
 {
   return this->element == other;
@@ -452,10 +553,44 @@ bool List::ListEntry::operator==(Element* other)
 
 void CustomDrawer::draw(gfx::Renderer* renderer)
 {
-  this->m_renderFunc(renderer,
-                     this->getX(),
-                     this->getY(),
-                     this->getWidth(),
-                     this->getHeight());
+  if (!this->m_cached) {
+    // Nothing is known about what gets drawn, so redraw it every frame
+    renderer->addDamage(
+        this->getX(), this->getY(), this->getWidth(), this->getHeight());
+
+    this->m_renderFunc(renderer,
+                       this->getX(),
+                       this->getY(),
+                       this->getWidth(),
+                       this->getHeight());
+    return;
+  }
+
+  if (this->m_canvas.getWidth() != this->getWidth()
+      || this->m_canvas.getHeight() != this->getHeight())
+    this->m_canvas.resize(this->getWidth(), this->getHeight());
+
+  if (!this->m_canvas.isValid()) {
+    renderer->beginCanvas(this->m_canvas);
+    this->m_renderFunc(renderer, 0, 0, this->getWidth(), this->getHeight());
+    renderer->endCanvas();
+  }
+
+  renderer->drawCanvas(this->getX(), this->getY(), this->m_canvas);
+}
+
+void CustomDrawer::setCached(bool cached)
+{
+  // Same background the overlay frame fills the screen with, so the view
+  // looks the same either way
+  this->m_cached = cached;
+  this->m_canvas.setBackground({0x0, 0x0, 0x0, alphabackground});
+  this->markDirty();
+}
+
+void CustomDrawer::redraw()
+{
+  this->m_canvas.invalidate();
+  this->markDirty();
 }
 }  // namespace nikola::tsl::elm
\ No newline at end of file
@@ -0,0 +1,96 @@
+//
+// Created by pugemon on 16.10.26.
+//
+#include <cmath>
+#include <switch.h>
+
+#include "nikola/tesla/font_metrics.hpp"
+
+namespace tsl::gfx
+{
+
+void FontMetrics::Glyph::getBitmapBox(float scale, s32 (&bounds)[4]) const
+{
+  bounds[0] = static_cast<s32>(std::floor(this->x0 * scale));
+  bounds[1] = static_cast<s32>(std::floor(-this->y1 * scale));
+  bounds[2] = static_cast<s32>(std::ceil(this->x1 * scale));
+  bounds[3] = static_cast<s32>(std::ceil(-this->y0 * scale));
+}
+
+void FontMetrics::setFonts(stbtt_fontinfo* stdFont, stbtt_fontinfo* extFont)
+{
+  stbtt_fontinfo* fonts[] = {extFont, stdFont};
+
+  for (u8 i = 0; i < this->m_fonts.size(); i++) {
+    Font& font = this->m_fonts[i];
+    int ascent = 0, descent = 0, lineGap = 0;
+    int advance = 0, leftSideBearing = 0;
+
+    stbtt_GetFontVMetrics(fonts[i], &ascent, &descent, &lineGap);
+    stbtt_GetCodepointHMetrics(fonts[i], 'W', &advance, &leftSideBearing);
+
+    font = {fonts[i], i, ascent - descent, advance};
+  }
+
+  this->m_flatResolved.reset();
+  this->m_glyphs.clear();
+}
+
+const FontMetrics::Glyph& FontMetrics::get(u32 codepoint)
+{
+  if (codepoint < FlatTableSize) {
+    if (!this->m_flatResolved[codepoint]) {
+      this->m_flatGlyphs[codepoint] = this->resolve(codepoint);
+      this->m_flatResolved[codepoint] = true;
+    }
+
+    return this->m_flatGlyphs[codepoint];
+  }
+
+  if (auto it = this->m_glyphs.find(codepoint); it != this->m_glyphs.end())
+    return it->second;
+
+  return this->m_glyphs.emplace(codepoint, this->resolve(codepoint))
+      .first->second;
+}
+
+FontMetrics::Glyph FontMetrics::resolve(u32 codepoint) const
+{
+  const Font* font = &this->m_fonts[0];
+  s32 index = stbtt_FindGlyphIndex(font->info, codepoint);
+
+  if (index == 0) {
+    font = &this->m_fonts[1];
+    index = stbtt_FindGlyphIndex(font->info, codepoint);
+  }
+
+  Glyph glyph = {font, index, 0, 0, 0, 0, 0};
+
+  int advance = 0, leftSideBearing = 0;
+  stbtt_GetGlyphHMetrics(font->info, index, &advance, &leftSideBearing);
+  glyph.advance = advance;
+
+  int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+  if (stbtt_GetGlyphBox(font->info, index, &x0, &y0, &x1, &y1)) {
+    glyph.x0 = x0;
+    glyph.y0 = y0;
+    glyph.x1 = x1;
+    glyph.y1 = y1;
+  }
+
+  return glyph;
+}
+
+u32 fingerprintFont(const stbtt_fontinfo* font)
+{
+  const u8* directory = font->data + font->fontstart;
+  const u32 tableCount = directory[4] << 8 | directory[5];
+
+  u32 hash = 0x811C9DC5;
+  for (u32 i = 0; i < 12 + 16 * tableCount; i++)
+    hash = (hash ^ directory[i]) * 0x01000193;
+
+  return hash;
+}
+
+}  // namespace tsl::gfx
@@ -0,0 +1,153 @@
+//
+// Created by pugemon on 16.10.26.
+//
+#include <algorithm>
+#include <utility>
+
+#if !defined(__SWITCH__)
+#  include <chrono>
+#endif
+
+#include <switch.h>
+
+#include "nikola/tesla/frame_pacer.hpp"
+
+namespace tsl::gfx
+{
+
+namespace
+{
+
+/**
+ * @brief Exponential moving average, starts out at the first sample
+ *
+ * @param average Current average, 0 if there is none yet
+ * @param sample New sample
+ * @param weight Inverse weight of the new sample
+ * @return New average
+ */
+u64 movingAverage(u64 average, u64 sample, s64 weight)
+{
+  if (average == 0)
+    return sample;
+
+  return average
+      + (static_cast<s64>(sample) - static_cast<s64>(average)) / weight;
+}
+
+}  // namespace
+
+FramePacer::FramePacer(Clock clock)
+    : m_clock(std::move(clock))
+{
+  if (!this->m_clock)
+    this->m_clock = []
+    {
+#if defined(__SWITCH__)
+      return armTicksToNs(armGetSystemTick());
+#else
+      return static_cast<u64>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now().time_since_epoch())
+              .count());
+#endif
+    };
+}
+
+void FramePacer::configure(PacingMode mode, u32 fps)
+{
+  fps = std::max<u32>(fps, 1);
+
+  if (mode == this->m_mode && fps == this->m_fps)
+    return;
+
+  this->m_mode = mode;
+  this->m_fps = fps;
+
+  if (mode == PacingMode::FixedInterval)
+    this->m_period = 1'000'000'000 / fps;
+  else {
+    this->m_vsyncInterval = std::max<u32>((60 + fps / 2) / fps, 1);
+    this->m_period = this->m_vsyncInterval * VSyncPeriod;
+  }
+
+  this->m_lastPresent = 0;
+  this->m_deadline = 0;
+}
+
+u64 FramePacer::getStartDelay() const
+{
+  if (this->m_mode != PacingMode::LowLatency || this->m_lastPresent == 0)
+    return 0;
+
+  // Aim to be done a little before the vsync the frame gets presented on
+  const u64 start = this->m_lastPresent + this->m_period
+      - std::min(this->m_stats.averageRenderTime + LowLatencyMargin,
+                 this->m_period);
+  const u64 now = this->m_clock();
+
+  return start > now ? start - now : 0;
+}
+
+void FramePacer::onFrameStart()
+{
+  this->m_frameStart = this->m_clock();
+}
+
+FramePacer::Present FramePacer::onFrameEnd()
+{
+  const u64 now = this->m_clock();
+
+  // Long pauses, e.g. while the overlay is hidden, aren't rendering time
+  const u64 renderTime = std::min(now - this->m_frameStart, this->m_period);
+  this->m_stats.averageRenderTime =
+      movingAverage(this->m_stats.averageRenderTime, renderTime, 8);
+
+  switch (this->m_mode) {
+    case PacingMode::FixedInterval:
+      if (this->m_deadline == 0)
+        this->m_deadline = now;
+
+      return {this->m_deadline > now ? this->m_deadline - now : 0, 0};
+    case PacingMode::LowLatency:
+      return {0, 1};
+    case PacingMode::VSync:
+    default:
+      return {0, this->m_vsyncInterval};
+  }
+}
+
+void FramePacer::onPresented()
+{
+  const u64 now = this->m_clock();
+
+  if (this->m_lastPresent != 0) {
+    const u64 frameTime = now - this->m_lastPresent;
+    auto& stats = this->m_stats;
+
+    stats.lastFrameTime = frameTime;
+    stats.averageFrameTime =
+        movingAverage(stats.averageFrameTime, frameTime, 16);
+
+    const u64 deviation = frameTime > stats.averageFrameTime
+        ? frameTime - stats.averageFrameTime
+        : stats.averageFrameTime - frameTime;
+    stats.jitter = movingAverage(stats.jitter, deviation, 16);
+
+    if (frameTime > this->m_period + this->m_period / 2)
+      stats.missedFrames++;
+  }
+
+  this->m_stats.frames++;
+  this->m_lastPresent = now;
+
+  if (this->m_mode == PacingMode::FixedInterval) {
+    this->m_deadline += this->m_period;
+
+    // More than a whole frame behind, start a new grid instead of catching up
+    if (this->m_deadline <= now)
+      this->m_deadline = now + this->m_period;
+  }
+}
+
+}  // namespace tsl::gfx
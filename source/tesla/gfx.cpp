@@ -1,14 +1,26 @@
 //
 // Created by pugemon on 29.08.24.
 //
+#include <bit>
 #include <cmath>
+#include <span>
+#include <tuple>
 #include <switch.h>
 
 #include "nikola/tesla/gfx.hpp"
 
 #include "nikola/tesla.hpp"
+#include "nikola/tesla/baked_glyphs.hpp"
+#include "nikola/tesla/blend.hpp"
+#include "nikola/tesla/canvas.hpp"
 #include "nikola/tesla/cfg.hpp"
 #include "nikola/tesla/hlp.hpp"
+#include "nikola/tesla/utf8.hpp"
+
+// Set by CMake, glyph cache files don't survive a version change
+#if !defined(NIKOLA_VERSION)
+#  define NIKOLA_VERSION "unknown"
+#endif
 
 #define ASSERT_FATAL(x) \
   if (Result res = x; R_FAILED(res)) \
@@ -17,6 +29,271 @@
 namespace tsl::gfx
 {
 
+namespace
+{
+
+/**
+ * @brief Splits the pixels [x0, x1) of a framebuffer row into the runs of up
+ * to 8 pixels that are stored next to each other in the block linear layout
+ *
+ * @param row Start of the row
+ * @param columnOffsets Swizzle offset of every column
+ * @param linear Row is stored linearly and makes up a single run
+ * @param x0 Left edge, inclusive
+ * @param x1 Right edge, exclusive
+ * @param f Called with the first pixel, the x pos and the length of every run
+ */
+template<typename F>
+inline void forEachRun(u16* row,
+                       const std::vector<u32>& columnOffsets,
+                       bool linear,
+                       s32 x0,
+                       s32 x1,
+                       F&& f)
+{
+  if (linear) {
+    f(row + x0, x0, x1 - x0);
+    return;
+  }
+
+  s32 x = x0;
+  while (x < x1) {
+    const s32 runLength = std::min<s32>(8 - (x & 7), x1 - x);
+    f(row + columnOffsets[x], x, runLength);
+    x += runLength;
+  }
+}
+
+/**
+ * @brief Converts the distance of a pixel center to the edge of a shape into
+ * the coverage of that pixel
+ *
+ * @param distance Distance in pixels, positive inside the shape
+ * @return Coverage, 0 - 255
+ */
+inline u8 edgeCoverage(float distance)
+{
+  return std::clamp(distance + 0.5F, 0.0F, 1.0F) * 255.0F + 0.5F;
+}
+
+/**
+ * @brief Interpolates a gradient color, channel by channel with rounding
+ *
+ * @param from First color
+ * @param to Last color
+ * @param i Step
+ * @param steps Number of steps
+ * @return Color of the step
+ */
+inline Color gradientColor(Color from, Color to, s32 i, s32 steps)
+{
+  if (steps <= 1)
+    return from;
+
+  const auto lerp = [&](u8 a, u8 b) -> u8
+  { return (a * (steps - 1 - i) + b * i + (steps - 1) / 2) / (steps - 1); };
+
+  return {lerp(from.r, to.r),
+          lerp(from.g, to.g),
+          lerp(from.b, to.b),
+          lerp(from.a, to.a)};
+}
+
+/**
+ * @brief Walks the pixels of a line with integer steps, starting right at the
+ * clip rect instead of at the first end point
+ * @note Lines are always walked in the same direction, so a line and its
+ * reverse cover the same pixels
+ *
+ * @param x0 Start X pos
+ * @param y0 Start Y pos
+ * @param x1 End X pos
+ * @param y1 End Y pos
+ * @param clip Clip rect as x0, y0, x1, y1 with exclusive right and bottom edges
+ * @param f Called with the x and y pos of every pixel inside the clip rect and
+ * its distance from the start point along the major axis
+ */
+template<typename F>
+void traceLine(
+    s32 x0, s32 y0, s32 x1, s32 y1, const s32 (&clip)[4], F&& f)
+{
+  // Walk along the major axis u, stepping the minor axis v when needed
+  const bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+  s32 u0 = steep ? y0 : x0, v0 = steep ? x0 : y0;
+  s32 u1 = steep ? y1 : x1, v1 = steep ? x1 : y1;
+
+  const bool reversed = u0 > u1;
+  if (reversed) {
+    std::swap(u0, u1);
+    std::swap(v0, v1);
+  }
+
+  const s32 du = u1 - u0, dv = std::abs(v1 - v0), sv = v1 < v0 ? -1 : 1;
+  const s32 clipU0 = clip[steep], clipU1 = clip[2 + steep];
+  const s32 clipV0 = clip[!steep], clipV1 = clip[2 + !steep];
+
+  const s32 first = std::max(u0, clipU0), last = std::min(u1, clipU1 - 1);
+
+  // v is v0 + round(k * dv / du) after k steps. Keeping the division as a
+  // quotient and remainder lets the walk start anywhere on the line
+  const s64 denominator = 2 * s64(std::max(du, 1));
+  const s64 numerator = 2 * s64(first - u0) * dv + du;
+  s32 v = v0 + sv * s32(numerator / denominator);
+  s64 remainder = numerator % denominator;
+
+  for (s32 u = first; u <= last; u++) {
+    if (v >= clipV0 && v < clipV1)
+      f(steep ? v : u, steep ? u : v, reversed ? u1 - u : u - u0);
+    else if (sv > 0 ? v >= clipV1 : v < clipV0)
+      break;
+
+    remainder += 2 * dv;
+    if (remainder >= denominator) {
+      remainder -= denominator;
+      v += sv;
+    }
+  }
+}
+
+/**
+ * @brief Positions the glyphs of a decoded string
+ *
+ * @param fontMetrics Metrics to lay the string out with
+ * @param codepoints Codepoints of the string
+ * @param monospace Use the advance of 'W' for every character
+ * @param x X pos
+ * @param y Y pos
+ * @param fontSize Height of the text in pixels
+ * @param f Called with the codepoint, the top left of the bitmap, the font and
+ * the font scale of every glyph that isn't whitespace
+ * @return Dimensions of the string
+ */
+template<typename F>
+std::pair<u32, u32> shapeString(FontMetrics& fontMetrics,
+                                std::span<const u32> codepoints,
+                                bool monospace,
+                                u32 x,
+                                u32 y,
+                                float fontSize,
+                                F&& f)
+{
+  u32 maxX = x;
+  u32 currX = x;
+  u32 currY = y;
+
+  for (const u32 currCharacter : codepoints) {
+    if (currCharacter == '\n') {
+      maxX = std::max(currX, maxX);
+
+      currX = x;
+      currY += fontSize;
+
+      continue;
+    }
+
+    const FontMetrics::Glyph& glyph = fontMetrics.get(currCharacter);
+    const FontMetrics::Font& currFont = *glyph.font;
+
+    float currFontSize = currFont.getScale(fontSize);
+    const s32 xAdvance = monospace ? currFont.monospaceAdvance : glyph.advance;
+
+    if (!isSpace(currCharacter) && fontSize > 0) {
+      int bounds[4] = {0};
+      glyph.getBitmapBox(currFontSize, bounds);
+
+      f(currCharacter,
+        currX + bounds[0],
+        currY + bounds[1],
+        currFont.info,
+        currFontSize);
+    }
+
+    currX += xAdvance * currFontSize;
+  }
+
+  maxX = std::max(currX, maxX);
+
+  return {maxX - x, currY - y};
+}
+
+
+/**
+ * @brief Gets how far \ref shapeString moves the pen for a codepoint
+ *
+ * @param fontMetrics Metrics to measure the codepoint with
+ * @param codepoint Unicode codepoint
+ * @param fontSize Height of the text in pixels
+ * @return Advance in pixels
+ */
+u32 glyphAdvance(FontMetrics& fontMetrics, u32 codepoint, float fontSize)
+{
+  const FontMetrics::Glyph& glyph = fontMetrics.get(codepoint);
+  const float scale = glyph.font->getScale(fontSize);
+
+  // Truncated, same as the pen position in shapeString
+  return glyph.advance * scale;
+}
+
+/**
+ * @brief Set on a thread while it rasterizes a tile of a recorded frame. Draw
+ * calls then clip to the tile and leave recording and block tracking alone
+ */
+struct TileState
+{
+  bool active = false;
+  s32 clip[4];  ///< Tile bounds intersected with the command's scissor
+};
+
+thread_local TileState t_tile;
+
+/**
+ * @brief Blend table of the color the last glyph on this thread was drawn in
+ */
+thread_local blend::CoverageTable t_coverageTable;
+
+/**
+ * @brief Blends the runs of a row that have any coverage with \ref
+ * t_coverageTable
+ *
+ * @param row Start of the row
+ * @param columnOffsets Swizzle offset of every column
+ * @param linear Row is stored linearly
+ * @param x0 Left edge, inclusive
+ * @param x1 Right edge, exclusive
+ * @param coverage Coverage of the pixels [x0, x1), 0 - 15
+ */
+void blendCoverageRuns(u16* row,
+                       const std::vector<u32>& columnOffsets,
+                       bool linear,
+                       s32 x0,
+                       s32 x1,
+                       const u8* coverage)
+{
+  s32 runX = x0;
+  while (runX < x1) {
+    while (runX < x1 && coverage[runX - x0] == 0)
+      runX++;
+
+    s32 runEnd = runX;
+    while (runEnd < x1 && coverage[runEnd - x0] != 0)
+      runEnd++;
+
+    forEachRun(row,
+               columnOffsets,
+               linear,
+               runX,
+               runEnd,
+               [&](u16* run, s32 pixelX, s32 length)
+               {
+                 blend::coverage(
+                     run, coverage + (pixelX - x0), length, t_coverageTable);
+               });
+    runX = runEnd;
+  }
+}
+
+}  // namespace
+
 bool isValidHexColor(const std::string& hexColor)
 {
   // Check if the string is a valid hexadecimal color of the format "#RRGGBB"
@@ -69,44 +346,69 @@ Color Renderer::a(const Color& c)
 
 void Renderer::enableScissoring(u16 x, u16 y, u16 w, u16 h)
 {
-  this->m_scissoring = true;
-
-  this->m_scissorBounds[0] = x;
-  this->m_scissorBounds[1] = y;
-  this->m_scissorBounds[2] = w;
-  this->m_scissorBounds[3] = h;
+  this->m_clipStack.push_back({x, y, x + w, y + h});
 }
 
 void Renderer::disableScissoring()
 {
-  this->m_scissoring = false;
+  this->popClip();
+}
+
+void Renderer::pushClip(s32 x, s32 y, s32 w, s32 h)
+{
+  const auto& [x0, y0, x1, y1] = this->m_clipStack.back();
+
+  this->m_clipStack.push_back({std::max(x, x0),
+                               std::max(y, y0),
+                               std::min(x + w, x1),
+                               std::min(y + h, y1)});
+}
+
+void Renderer::popClip()
+{
+  if (this->m_clipStack.size() > 1)
+    this->m_clipStack.pop_back();
 }
 
 void Renderer::setPixel(s16 x, s16 y, Color color)
 {
-  if (x < 0 || y < 0 || x >= cfg::FramebufferWidth
-      || y >= cfg::FramebufferHeight)
+  if (this->isRecording()) {
+    this->record({DrawCommand::Type::Pixel, color, {x, y}}, x, y, x + 1, y + 1);
+    return;
+  }
+
+  if (this->isOutsideFrame(x, y))
     return;
 
+  this->markBlocksDirty(x, y, x + 1, y + 1);
+
   static_cast<Color*>(
-      this->getCurrentFramebuffer())[this->getPixelOffset(x, y)] = color;
+      this->getRenderTarget())[this->getPixelOffset(x, y)] = color;
 }
 
 u8 Renderer::blendColor(u8 src, u8 dst, u8 alpha)
 {
   u8 oneMinusAlpha = 0x0F - alpha;
 
-  return (dst * alpha + src * oneMinusAlpha) / float(0xF);
+  return (dst * alpha + src * oneMinusAlpha) / 0xF;
 }
 
 void Renderer::setPixelBlendSrc(s16 x, s16 y, Color color)
 {
-  if (x < 0 || y < 0 || x >= cfg::FramebufferWidth
-      || y >= cfg::FramebufferHeight)
+  if (this->isRecording()) {
+    this->record(
+        {DrawCommand::Type::PixelBlendSrc, color, {x, y}}, x, y, x + 1, y + 1);
+    return;
+  }
+
+  if (this->isOutsideFrame(x, y))
     return;
 
-  Color src((static_cast<u16*>(
-      this->getCurrentFramebuffer()))[this->getPixelOffset(x, y)]);
+  this->markBlocksDirty(x, y, x + 1, y + 1);
+
+  u16* pixel = static_cast<u16*>(this->getRenderTarget())
+      + this->getPixelOffset(x, y);
+  Color src(*pixel);
   Color dst(color);
   Color end(0);
 
@@ -115,17 +417,25 @@ void Renderer::setPixelBlendSrc(s16 x, s16 y, Color color)
   end.b = this->blendColor(src.b, dst.b, dst.a);
   end.a = src.a;
 
-  this->setPixel(x, y, end);
+  *pixel = end.rgba;
 }
 
 void Renderer::setPixelBlendDst(s16 x, s16 y, Color color)
 {
-  if (x < 0 || y < 0 || x >= cfg::FramebufferWidth
-      || y >= cfg::FramebufferHeight)
+  if (this->isRecording()) {
+    this->record(
+        {DrawCommand::Type::PixelBlendDst, color, {x, y}}, x, y, x + 1, y + 1);
+    return;
+  }
+
+  if (this->isOutsideFrame(x, y))
     return;
 
-  Color src((static_cast<u16*>(
-      this->getCurrentFramebuffer()))[this->getPixelOffset(x, y)]);
+  this->markBlocksDirty(x, y, x + 1, y + 1);
+
+  u16* pixel = static_cast<u16*>(this->getRenderTarget())
+      + this->getPixelOffset(x, y);
+  Color src(*pixel);
   Color dst(color);
   Color end(0);
 
@@ -134,142 +444,620 @@ void Renderer::setPixelBlendDst(s16 x, s16 y, Color color)
   end.b = this->blendColor(src.b, dst.b, dst.a);
   end.a = dst.a;
 
-  this->setPixel(x, y, end);
+  *pixel = end.rgba;
 }
 
 void Renderer::drawRect(s16 x, s16 y, s16 w, s16 h, Color color)
 {
-  for (s16 x1 = x; x1 < (x + w); x1++)
-    for (s16 y1 = y; y1 < (y + h); y1++)
-      this->setPixelBlendDst(x1, y1, color);
+  if (this->isRecording()) {
+    this->record(
+        {DrawCommand::Type::Rect, color, {x, y, w, h}}, x, y, x + w, y + h);
+    return;
+  }
+
+  s32 x0 = x, y0 = y, x1 = x + w, y1 = y + h;
+
+  if (!this->clipRect(x0, y0, x1, y1))
+    return;
+
+  this->fillSpans(x0, y0, x1, y1, color);
+}
+
+void Renderer::drawRoundedRect(
+    s16 x, s16 y, s16 w, s16 h, s16 radius, Color color)
+{
+  if (this->isRecording()) {
+    this->record({DrawCommand::Type::RoundedRect, color, {x, y, w, h, radius}},
+                 x,
+                 y,
+                 x + w,
+                 y + h);
+    return;
+  }
+
+  s32 x0 = x, y0 = y, x1 = x + w, y1 = y + h;
+
+  if (!this->clipRect(x0, y0, x1, y1))
+    return;
+
+  // Corner centers, pixel centers sit at .5
+  const float r = std::clamp<s32>(radius, 0, std::min(w, h) / 2);
+  const float left = x + r, right = x + w - r;
+  const float top = y + r, bottom = y + h - r;
+
+  u8 coverage[cfg::LayerMaxWidth];
+
+  for (s32 row = y0; row < y1; row++) {
+    const float dy =
+        std::max({top - (row + 0.5F), (row + 0.5F) - bottom, 0.0F});
+
+    // Rows between the corners are fully covered
+    if (dy == 0) {
+      this->fillSpans(x0, row, x1, row + 1, color);
+      continue;
+    }
+
+    // Pixels closer than r - 0.5 to the corner centers are fully covered,
+    // ones further away than r + 0.5 not at all
+    const float outerSq = (r + 0.5F) * (r + 0.5F) - dy * dy;
+    if (outerSq <= 0)
+      continue;
+
+    const float outer = std::sqrt(outerSq);
+    const s32 edge0 = std::max<s32>(x0, std::floor(left - outer - 0.5F));
+    const s32 edge1 = std::min<s32>(x1, std::ceil(right + outer - 0.5F) + 1);
+
+    s32 full0 = edge1, full1 = edge1;
+    if (const float innerSq = (r - 0.5F) * (r - 0.5F) - dy * dy; innerSq >= 0)
+    {
+      const float inner = std::sqrt(innerSq);
+      full0 = std::clamp<s32>(std::ceil(left - inner - 0.5F), edge0, edge1);
+      full1 = std::clamp<s32>(
+          std::floor(right + inner - 0.5F) + 1, full0, edge1);
+    }
+
+    const auto blendEdge = [&](s32 from, s32 to)
+    {
+      for (s32 column = from; column < to; column++) {
+        const float dx = std::max(
+            {left - (column + 0.5F), (column + 0.5F) - right, 0.0F});
+        coverage[column - from] = edgeCoverage(r - std::hypot(dx, dy));
+      }
+
+      if (from < to)
+        this->blendCoverage(row, from, to, coverage, color);
+    };
+
+    blendEdge(edge0, full0);
+    if (full0 < full1)
+      this->fillSpans(full0, row, full1, row + 1, color);
+    blendEdge(full1, edge1);
+  }
+}
+
+void Renderer::drawCircle(s16 x, s16 y, s16 radius, Color color)
+{
+  this->drawRoundedRect(
+      x - radius, y - radius, 2 * radius, 2 * radius, radius, color);
+}
+
+void Renderer::drawArc(s16 x,
+                       s16 y,
+                       s16 radius,
+                       s16 thickness,
+                       s16 startAngle,
+                       s16 endAngle,
+                       Color color)
+{
+  if (this->isRecording()) {
+    this->record({DrawCommand::Type::Arc,
+                  color,
+                  {x, y, radius, thickness, startAngle, endAngle}},
+                 x - radius,
+                 y - radius,
+                 x + radius,
+                 y + radius);
+    return;
+  }
+
+  s32 x0 = x - radius, y0 = y - radius, x1 = x + radius, y1 = y + radius;
+
+  if (radius <= 0 || thickness <= 0 || !this->clipRect(x0, y0, x1, y1))
+    return;
+
+  constexpr float Pi = M_PI;
+
+  const float outer = radius;
+  const float inner = std::max(radius - thickness, 0);
+  const float start = startAngle * Pi / 180;
+
+  float sweep = std::fmod(float(endAngle - startAngle), 360.0F);
+  if (sweep <= 0)
+    sweep += 360;
+  const bool fullRing = endAngle - startAngle >= 360;
+  sweep *= Pi / 180;
+
+  u8 coverage[cfg::LayerMaxWidth];
+
+  for (s32 row = y0; row < y1; row++) {
+    const float dy = row + 0.5F - y;
+
+    // Pixels in the hole of the ring aren't touched
+    const float holeSq = (inner - 0.5F) * (inner - 0.5F) - dy * dy;
+    const float hole = inner > 0.5F && holeSq > 0 ? std::sqrt(holeSq) : -1;
+
+    const auto blendRange = [&](s32 from, s32 to)
+    {
+      from = std::max(from, x0);
+      to = std::min(to, x1);
+
+      for (s32 column = from; column < to; column++) {
+        const float dx = column + 0.5F - x;
+        const float distance = std::hypot(dx, dy);
+
+        float edge = std::min(outer - distance,
+                              inner > 0 ? distance - inner : outer);
+
+        if (!fullRing) {
+          // Distance to the closer of the two straight edges, negative
+          // outside of the sweep
+          float angle = std::fmod(std::atan2(dy, dx) - start, 2 * Pi);
+          if (angle < 0)
+            angle += 2 * Pi;
+
+          const float angular = angle <= sweep
+              ? std::min(angle, sweep - angle)
+              : -std::min(angle - sweep, 2 * Pi - angle);
+          edge = std::min(edge, angular * distance);
+        }
+
+        coverage[column - from] = edgeCoverage(edge);
+      }
+
+      if (from < to)
+        this->blendCoverage(row, from, to, coverage, color);
+    };
+
+    if (hole < 0)
+      blendRange(x0, x1);
+    else {
+      blendRange(x0, std::ceil(x - hole - 0.5F));
+      blendRange(std::floor(x + hole - 0.5F) + 1, x1);
+    }
+  }
+}
+
+void Renderer::drawGradientRect(
+    s16 x, s16 y, s16 w, s16 h, Color from, Color to, bool vertical)
+{
+  if (this->isRecording()) {
+    this->record(
+        {DrawCommand::Type::Gradient, from, {x, y, w, h, vertical}, to.rgba},
+        x,
+        y,
+        x + w,
+        y + h);
+    return;
+  }
+
+  s32 x0 = x, y0 = y, x1 = x + w, y1 = y + h;
+
+  if (!this->clipRect(x0, y0, x1, y1))
+    return;
+
+  // 4 bit channels only have a few distinct steps, neighbouring rows or
+  // columns with the same color get filled as one rectangle
+  const s32 begin = vertical ? y0 : x0, end = vertical ? y1 : x1;
+  const s32 origin = vertical ? y : x, steps = vertical ? h : w;
+
+  for (s32 i = begin; i < end;) {
+    const Color color = gradientColor(from, to, i - origin, steps);
+
+    s32 next = i + 1;
+    while (next < end
+           && gradientColor(from, to, next - origin, steps).rgba == color.rgba)
+      next++;
+
+    if (vertical)
+      this->fillSpans(x0, i, x1, next, color);
+    else
+      this->fillSpans(i, y0, next, y1, color);
+
+    i = next;
+  }
 }
 
 void Renderer::drawEmptyRect(s16 x, s16 y, s16 w, s16 h, Color color)
 {
-  if (x < 0 || y < 0 || x >= cfg::FramebufferWidth
-      || y >= cfg::FramebufferHeight)
+  if (w < 0 || h < 0)
     return;
 
-  for (s16 x1 = x; x1 <= (x + w); x1++)
-    for (s16 y1 = y; y1 <= (y + h); y1++)
-      if (y1 == y || x1 == x || y1 == y + h || x1 == x + w)
-        this->setPixelBlendDst(x1, y1, color);
+  // The border includes the pixels at x + w and y + h
+  this->drawRect(x, y, w + 1, 1, color);
+  if (h > 0)
+    this->drawRect(x, y + h, w + 1, 1, color);
+  if (h > 1) {
+    this->drawRect(x, y + 1, 1, h - 1, color);
+    if (w > 0)
+      this->drawRect(x + w, y + 1, 1, h - 1, color);
+  }
 }
 
 void Renderer::drawLine(s16 x0, s16 y0, s16 x1, s16 y1, Color color)
 {
-  if ((x0 == x1) && (y0 == y1)) {
-    this->setPixelBlendDst(x0, y0, color);
+  if (this->isRecording()) {
+    this->record({DrawCommand::Type::Line, color, {x0, y0, x1, y1}},
+                 std::min(x0, x1),
+                 std::min(y0, y1),
+                 std::max(x0, x1) + 1,
+                 std::max(y0, y1) + 1);
     return;
   }
 
-  s16 x_max = std::max(x0, x1);
-  s16 y_max = std::max(y0, y1);
-  s16 x_min = std::min(x0, x1);
-  s16 y_min = std::min(y0, y1);
+  s32 clip[4] = {std::min(x0, x1),
+                 std::min(y0, y1),
+                 std::max(x0, x1) + 1,
+                 std::max(y0, y1) + 1};
 
-  if (x_min < 0 || y_min < 0 || x_min >= cfg::FramebufferWidth
-      || y_min >= cfg::FramebufferHeight)
+  if (!this->clipRect(clip[0], clip[1], clip[2], clip[3]))
     return;
 
-  // y = mx + b
-  s16 dy = y_max - y_min;
-  s16 dx = x_max - x_min;
+  u16* framebuffer = static_cast<u16*>(this->getRenderTarget());
+
+  // Pixels next to each other in a row are blended as one span
+  s32 spanX = 0, spanY = 0, spanLength = 0;
+  const auto flush = [&]
+  {
+    if (spanLength > 0)
+      forEachRun(framebuffer + this->m_rowOffsets[spanY],
+                 this->m_columnOffsets,
+                 this->m_linear,
+                 spanX,
+                 spanX + spanLength,
+                 [color](u16* run, s32, s32 length)
+                 { blend::fill(run, length, color); });
+  };
+
+  traceLine(x0,
+            y0,
+            x1,
+            y1,
+            clip,
+            [&](s32 x, s32 y, s32)
+            {
+              if (y == spanY && x == spanX + spanLength) {
+                spanLength++;
+                return;
+              }
+
+              flush();
+              spanX = x;
+              spanY = y;
+              spanLength = 1;
+            });
+
+  flush();
+}
 
-  if (dx == 0) {
-    for (s16 y = y_min; y <= y_max; y++) {
-      this->setPixelBlendDst(x_min, y, color);
-    }
+void Renderer::drawAntiAliasedLine(
+    s16 x0, s16 y0, s16 x1, s16 y1, Color color)
+{
+  if (this->isRecording()) {
+    this->record({DrawCommand::Type::AntiAliasedLine, color, {x0, y0, x1, y1}},
+                 std::min(x0, x1),
+                 std::min(y0, y1),
+                 std::max(x0, x1) + 1,
+                 std::max(y0, y1) + 1);
+    return;
+  }
+
+  s32 clip[4] = {std::min(x0, x1),
+                 std::min(y0, y1),
+                 std::max(x0, x1) + 1,
+                 std::max(y0, y1) + 1};
+
+  if (!this->clipRect(clip[0], clip[1], clip[2], clip[3]))
     return;
+
+  u16* framebuffer = static_cast<u16*>(this->getRenderTarget());
+
+  // Xiaolin Wu's algorithm: every step along the major axis covers the two
+  // pixels closest to the exact line, weighted by the distance to them
+  const bool steep = std::abs(y1 - y0) > std::abs(x1 - x0);
+  s32 u0 = steep ? y0 : x0, v0 = steep ? x0 : y0;
+  s32 u1 = steep ? y1 : x1, v1 = steep ? x1 : y1;
+
+  if (u0 > u1) {
+    std::swap(u0, u1);
+    std::swap(v0, v1);
   }
 
-  float m = (float)dy / float(dx);
-  float b = y_min - (m * x_min);
+  const s32 du = u1 - u0, dv = std::abs(v1 - v0), sv = v1 < v0 ? -1 : 1;
+  const s32 clipU0 = clip[steep], clipU1 = clip[2 + steep];
+  const s32 clipV0 = clip[!steep], clipV1 = clip[2 + !steep];
 
-  for (s16 x = x_min; x <= x_max; x++) {
-    s16 y = std::lround((m * (float)x) + b);
-    s16 y_end = std::lround((m * (float)(x + 1)) + b);
-    if (y == y_end) {
-      if (x <= x_max && y <= y_max)
-        this->setPixelBlendDst(x, y, color);
-    } else
-      while (y < y_end) {
-        if (x <= x_max && y <= y_max)
-          this->setPixelBlendDst(x, y, color);
-        y += 1;
+  const s32 first = std::max(u0, clipU0), last = std::min(u1, clipU1 - 1);
+
+  // Distance along the minor axis in 1/256 pixels, kept as quotient and
+  // remainder of an exact division
+  const s64 step = s64(dv) * 256;
+  s64 quotient = 0, remainder = 0;
+  if (du > 0) {
+    quotient = step * (first - u0) / du;
+    remainder = step * (first - u0) % du;
+  }
+
+  const auto plot = [&](s32 u, s32 v, u8 coverage)
+  {
+    if (coverage == 0 || v < clipV0 || v >= clipV1)
+      return;
+
+    const s32 x = steep ? v : u, y = steep ? u : v;
+    blend::mask(framebuffer + this->m_rowOffsets[y] + this->m_columnOffsets[x],
+                &coverage,
+                1,
+                color);
+  };
+
+  for (s32 u = first; u <= last; u++) {
+    const s32 v = v0 + sv * s32(quotient >> 8);
+    const u8 fraction = quotient & 0xFF;
+
+    plot(u, v, 0xFF - fraction);
+    plot(u, v + sv, fraction);
+
+    if (du > 0) {
+      quotient += step / du;
+      remainder += step % du;
+      if (remainder >= du) {
+        quotient++;
+        remainder -= du;
       }
+    }
   }
 }
 
 void Renderer::drawDashedLine(
     s16 x0, s16 y0, s16 x1, s16 y1, s16 line_width, Color color)
 {
-  // Source of formula:
-  // https://www.cc.gatech.edu/grads/m/Aaron.E.McClennen/Bresenham/code.html
+  if (this->isRecording()) {
+    this->record(
+        {DrawCommand::Type::DashedLine, color, {x0, y0, x1, y1, line_width}},
+        std::min(x0, x1),
+        std::min(y0, y1),
+        std::max(x0, x1) + 1,
+        std::max(y0, y1) + 1);
+    return;
+  }
 
-  s16 x_min = std::min(x0, x1);
-  s16 x_max = std::max(x0, x1);
-  s16 y_min = std::min(y0, y1);
-  s16 y_max = std::max(y0, y1);
+  if (line_width <= 0) {
+    this->drawLine(x0, y0, x1, y1, color);
+    return;
+  }
 
-  if (x_min < 0 || y_min < 0 || x_min >= cfg::FramebufferWidth
-      || y_min >= cfg::FramebufferHeight)
+  s32 clip[4] = {std::min(x0, x1),
+                 std::min(y0, y1),
+                 std::max(x0, x1) + 1,
+                 std::max(y0, y1) + 1};
+
+  if (!this->clipRect(clip[0], clip[1], clip[2], clip[3]))
     return;
 
-  s16 dx = x_max - x_min;
-  s16 dy = y_max - y_min;
-  s16 d = 2 * dy - dx;
-  s16 incrE = 2 * dy;
-  s16 incrNE = 2 * (dy - dx);
+  u16* framebuffer = static_cast<u16*>(this->getRenderTarget());
+
+  traceLine(x0,
+            y0,
+            x1,
+            y1,
+            clip,
+            [&](s32 x, s32 y, s32 step)
+            {
+              if ((step / line_width) % 2 == 0)
+                blend::fill(framebuffer + this->m_rowOffsets[y]
+                                + this->m_columnOffsets[x],
+                            1,
+                            color);
+            });
+}
 
-  this->setPixelBlendDst(x_min, y_min, color);
+void Renderer::drawBitmap(s16 x, s16 y, s16 w, s16 h, const u8* bmp)
+{
+  if (this->isRecording()) {
+    // The caller's bitmap may be gone by the time the frame gets rasterized
+    const u32 data = this->m_commandData.size();
+    if (this->record({DrawCommand::Type::Bitmap, 0, {x, y, w, h}, data},
+                     x,
+                     y,
+                     x + w,
+                     y + h))
+      this->m_commandData.insert(
+          this->m_commandData.end(), bmp, bmp + w * h * 4);
+    return;
+  }
 
-  s16 x = x_min;
-  s16 y = y_min;
-  s16 rendered = 0;
+  s32 x0 = x, y0 = y, x1 = x + w, y1 = y + h;
 
-  while (x < x1) {
-    if (d <= 0) {
-      d += incrE;
-      x++;
-    } else {
-      d += incrNE;
-      x++;
-      y++;
-    }
-    rendered++;
-    if (x < 0 || y < 0 || x >= cfg::FramebufferWidth
-        || y >= cfg::FramebufferHeight)
-      continue;
-    if (x <= x_max && y <= y_max) {
-      if (rendered > 0 && rendered < line_width) {
-        this->setPixelBlendDst(x, y, color);
-      } else if (rendered > 0 && rendered >= line_width) {
-        rendered *= -1;
-      }
-    }
+  if (!this->clipRect(x0, y0, x1, y1))
+    return;
+
+  // Same as passing every pixel through a(), but only done once per alpha
+  u16 alphaBits[16];
+  for (u8 alpha = 0; alpha < 16; alpha++)
+    alphaBits[alpha] = a(alpha << 12).rgba;
+
+  u16* framebuffer = static_cast<u16*>(this->getRenderTarget());
+  u16 rowPixels[cfg::LayerMaxWidth];
+
+  for (s32 row = y0; row < y1; row++) {
+    const u8* src = bmp + ((row - y) * w + (x0 - x)) * 4;
+    for (s32 i = 0; i < x1 - x0; i++, src += 4)
+      rowPixels[i] = (src[1] >> 4) | (src[2] >> 4) << 4 | (src[3] >> 4) << 8
+          | alphaBits[src[0] >> 4];
+
+    forEachRun(framebuffer + this->m_rowOffsets[row],
+               this->m_columnOffsets,
+               this->m_linear,
+               x0,
+               x1,
+               [&](u16* run, s32 runX, s32 length)
+               { blend::span(run, rowPixels + (runX - x0), length); });
   }
 }
 
-void Renderer::drawBitmap(s16 x, s16 y, s16 w, s16 h, const u8* bmp)
+void Renderer::drawImage(s16 x, s16 y, const Image& image)
 {
-  for (s32 y1 = 0; y1 < h; y1++) {
-    for (s32 x1 = 0; x1 < w; x1++) {
-      const Color color = {static_cast<u8>(bmp[1] >> 4),
-                           static_cast<u8>(bmp[2] >> 4),
-                           static_cast<u8>(bmp[3] >> 4),
-                           static_cast<u8>(bmp[0] >> 4)};
-      setPixelBlendSrc(x + x1, y + y1, a(color));
-      bmp += 4;
-    }
+  const s32 w = image.getWidth(), h = image.getHeight();
+
+  if (this->isRecording()) {
+    const u32 data = this->m_commandImages.size();
+    if (this->record(
+            {DrawCommand::Type::Image, 0, {x, y}, data}, x, y, x + w, y + h))
+      this->m_commandImages.push_back(&image);
+    return;
+  }
+
+  s32 x0 = x, y0 = y, x1 = x + w, y1 = y + h;
+
+  if (!this->clipRect(x0, y0, x1, y1))
+    return;
+
+  const u16 opacity = static_cast<u8>(0xF * Renderer::s_opacity);
+  u16* framebuffer = static_cast<u16*>(this->getRenderTarget());
+
+  for (s32 row = y0; row < y1; row++) {
+    const Image::RowType type = image.getRowType(row - y);
+
+    if (type == Image::RowType::Transparent)
+      continue;
+
+    const u16* src = image.getRow(row - y) + (x0 - x);
+
+    if (type == Image::RowType::Opaque && opacity == 0xF)
+      forEachRun(framebuffer + this->m_rowOffsets[row],
+                 this->m_columnOffsets,
+                 this->m_linear,
+                 x0,
+                 x1,
+                 [&](u16* run, s32 runX, s32 length)
+                 { blend::copy(run, src + (runX - x0), length); });
+    else
+      forEachRun(framebuffer + this->m_rowOffsets[row],
+                 this->m_columnOffsets,
+                 this->m_linear,
+                 x0,
+                 x1,
+                 [&](u16* run, s32 runX, s32 length) {
+                   blend::premultiplied(
+                       run, src + (runX - x0), length, opacity);
+                 });
   }
 }
 
+void Renderer::beginCanvas(Canvas& canvas)
+{
+  this->m_canvas = &canvas;
+
+  auto& saved = this->m_canvasSaved;
+  saved.linear = this->m_linear;
+  saved.recording = this->m_recording;
+  saved.opacity = Renderer::s_opacity;
+  std::copy_n(this->m_frameDamage, 4, saved.frameDamage);
+  saved.clipStack.swap(this->m_clipStack);
+
+  // Drawn right away and without fading, the opacity applies when the canvas
+  // gets shown
+  this->m_linear = true;
+  this->m_recording = false;
+  Renderer::s_opacity = 1.0F;
+
+  const s32 bounds[4] = {0, 0, canvas.m_width, canvas.m_height};
+  std::copy_n(bounds, 4, this->m_frameDamage);
+  this->m_clipStack.assign(1, {0, 0, canvas.m_width, canvas.m_height});
+
+  this->m_rowOffsets.swap(canvas.m_rowOffsets);
+  this->m_columnOffsets.swap(canvas.m_columnOffsets);
+
+  std::fill(
+      canvas.m_pixels.begin(), canvas.m_pixels.end(), canvas.m_background.rgba);
+}
+
+void Renderer::endCanvas()
+{
+  Canvas& canvas = *this->m_canvas;
+
+  this->m_rowOffsets.swap(canvas.m_rowOffsets);
+  this->m_columnOffsets.swap(canvas.m_columnOffsets);
+
+  auto& saved = this->m_canvasSaved;
+  this->m_linear = saved.linear;
+  this->m_recording = saved.recording;
+  Renderer::s_opacity = saved.opacity;
+  std::copy_n(saved.frameDamage, 4, this->m_frameDamage);
+  this->m_clipStack.swap(saved.clipStack);
+
+  this->m_canvas = nullptr;
+
+  // A canvas with a background covers what it's shown on, the color channels
+  // get copied like they would have been drawn there
+  if (canvas.m_background.a != 0)
+    for (u16& pixel : canvas.m_pixels)
+      pixel |= 0xF000;
+
+  canvas.m_image.loadPixels(
+      canvas.m_pixels.data(), canvas.m_width, canvas.m_height);
+  canvas.m_valid = true;
+}
+
+void Renderer::drawCanvas(s16 x, s16 y, const Canvas& canvas)
+{
+  if (canvas.isValid())
+    this->drawImage(x, y, canvas.m_image);
+}
+
 void Renderer::fillScreen(Color color)
 {
-  std::fill_n(static_cast<Color*>(this->getCurrentFramebuffer()),
-              this->getFramebufferSize() / sizeof(Color),
-              color);
+  if (this->isRecording()) {
+    this->record({DrawCommand::Type::Fill, color},
+                 0,
+                 0,
+                 cfg::FramebufferWidth,
+                 cfg::FramebufferHeight);
+    return;
+  }
+
+  auto [x0, y0, x1, y1] = this->m_frameDamage;
+
+  if (t_tile.active) {
+    x0 = std::max(x0, t_tile.clip[0]);
+    y0 = std::max(y0, t_tile.clip[1]);
+    x1 = std::min(x1, t_tile.clip[2]);
+    y1 = std::min(y1, t_tile.clip[3]);
+  }
+
+  if (x0 >= x1 || y0 >= y1)
+    return;
+
+  this->markBlocksDirty(x0, y0, x1, y1);
+
+  if (x0 == 0 && y0 == 0 && x1 == cfg::FramebufferWidth
+      && y1 == cfg::FramebufferHeight)
+  {
+    std::fill_n(static_cast<Color*>(this->getRenderTarget()),
+                this->getRenderTargetSize() / sizeof(Color),
+                color);
+    return;
+  }
+
+  u16* framebuffer = static_cast<u16*>(this->getRenderTarget());
+
+  for (s32 y = y0; y < y1; y++)
+    forEachRun(framebuffer + this->m_rowOffsets[y],
+               this->m_columnOffsets,
+               this->m_linear,
+               x0,
+               x1,
+               [color](u16* run, s32, s32 length)
+               { std::fill_n(run, length, color.rgba); });
 }
 
 void Renderer::clearScreen()
@@ -293,83 +1081,415 @@ Renderer& Renderer::getRenderer()
   return get();
 }
 
-std::pair<u32, u32> Renderer::drawString(const char* string,
+std::pair<u32, u32> Renderer::drawString(std::string_view string,
                                          bool monospace,
                                          u32 x,
                                          u32 y,
                                          float fontSize,
                                          Color color)
 {
-  const size_t stringLength = strlen(string);
+  if (color.a == 0x0)
+    return this->measureString(string, monospace, fontSize);
+
+  decodeUtf8(string, this->m_codepoints);
+
+  return shapeString(
+      this->m_fontMetrics,
+      this->m_codepoints,
+      monospace,
+      x,
+      y,
+      fontSize,
+      [&](u32 codepoint, s32 x, s32 y, stbtt_fontinfo* font, float scale)
+      { this->drawGlyph(codepoint, x, y, color, font, scale); });
+}
 
-  u32 maxX = x;
-  u32 currX = x;
-  u32 currY = y;
-  u32 prevCharacter = 0;
+std::pair<u32, u32> Renderer::measureString(std::string_view string,
+                                            bool monospace,
+                                            float fontSize)
+{
+  decodeUtf8(string, this->m_codepoints);
+
+  return shapeString(this->m_fontMetrics,
+                     this->m_codepoints,
+                     monospace,
+                     0,
+                     0,
+                     fontSize,
+                     [](u32, s32, s32, stbtt_fontinfo*, float) {});
+}
 
-  u32 i = 0;
+void Renderer::layoutString(TextLayout& layout,
+                            std::string_view string,
+                            bool monospace,
+                            float fontSize)
+{
+  layout.m_glyphs.clear();
+  decodeUtf8(string, this->m_codepoints);
+
+  std::tie(layout.m_width, layout.m_height) = shapeString(
+      this->m_fontMetrics,
+      this->m_codepoints,
+      monospace,
+      0,
+      0,
+      fontSize,
+      [&](u32 codepoint, s32 x, s32 y, stbtt_fontinfo* font, float scale)
+      { layout.m_glyphs.push_back({codepoint, x, y, font, scale}); });
+
+  layout.m_lineCount =
+      std::count(this->m_codepoints.begin(), this->m_codepoints.end(), '\n')
+      + 1;
+  layout.m_truncated = false;
+  layout.m_valid = true;
+  layout.m_paragraph = false;
+}
 
-  do {
-    u32 currCharacter;
-    ssize_t codepointWidth =
-        decode_utf8(&currCharacter, reinterpret_cast<const u8*>(string + i));
+void Renderer::layoutParagraph(TextLayout& layout,
+                               std::string_view string,
+                               float fontSize,
+                               const ParagraphStyle& style)
+{
+  if (layout.m_valid && layout.m_paragraph && layout.m_text == string
+      && layout.m_fontSize == fontSize && layout.m_style == style)
+    return;
 
-    if (codepointWidth <= 0)
-      break;
+  decodeUtf8(string, this->m_codepoints);
+  const std::vector<u32>& codepoints = this->m_codepoints;
+
+  std::vector<u32> advances(codepoints.size());
+  for (u32 i = 0; i < codepoints.size(); i++)
+    advances[i] = glyphAdvance(this->m_fontMetrics, codepoints[i], fontSize);
+
+  struct Line
+  {
+    u32 begin, end;  ///< Codepoint range, without the break
+    u32 width;
+    bool ellipsis = false;
+  };
+
+  std::vector<Line> lines;
+  const bool wrap = style.wrap && style.maxWidth > 0;
+  u32 begin = 0, width = 0;
+  // First space of the last gap between words on the line, 0 if there's none
+  u32 breakAt = 0, breakWidth = 0;
+
+  for (u32 i = 0; i < codepoints.size(); i++) {
+    const u32 codepoint = codepoints[i];
+
+    if (codepoint == '\n') {
+      lines.push_back({begin, i, width});
+      begin = i + 1;
+      width = breakAt = 0;
+      continue;
+    }
 
-    i += codepointWidth;
+    const bool space = isSpace(codepoint);
+
+    while (wrap && !space && i > begin
+           && width + advances[i] > style.maxWidth)
+    {
+      if (breakAt > begin) {
+        // Move the last word to the next line, the gap before it disappears
+        lines.push_back({begin, breakAt, breakWidth});
+        begin = breakAt;
+        while (begin < i && isSpace(codepoints[begin]))
+          begin++;
+        width = 0;
+        for (u32 j = begin; j < i; j++)
+          width += advances[j];
+        breakAt = 0;
+        continue;
+      }
 
-    stbtt_fontinfo* currFont = nullptr;
+      // A single word wider than a line gets broken anywhere
+      lines.push_back({begin, i, width});
+      begin = i;
+      width = 0;
+    }
 
-    if (stbtt_FindGlyphIndex(&this->m_extFont, currCharacter))
-      currFont = &this->m_extFont;
-    else
-      currFont = &this->m_stdFont;
-
-    float currFontSize = stbtt_ScaleForPixelHeight(currFont, fontSize);
-    currX += currFontSize
-        * stbtt_GetCodepointKernAdvance(currFont, prevCharacter, currCharacter);
-
-    int bounds[4] = {0};
-    stbtt_GetCodepointBitmapBoxSubpixel(currFont,
-                                        currCharacter,
-                                        currFontSize,
-                                        currFontSize,
-                                        0,
-                                        0,
-                                        &bounds[0],
-                                        &bounds[1],
-                                        &bounds[2],
-                                        &bounds[3]);
-
-    int xAdvance = 0, yAdvance = 0;
-    stbtt_GetCodepointHMetrics(
-        currFont, monospace ? 'W' : currCharacter, &xAdvance, &yAdvance);
+    if (space && i > begin && !isSpace(codepoints[i - 1])) {
+      breakAt = i;
+      breakWidth = width;
+    }
 
-    if (currCharacter == '\n') {
-      maxX = std::max(currX, maxX);
+    width += advances[i];
+  }
+  lines.push_back({begin, static_cast<u32>(codepoints.size()), width});
 
-      currX = x;
-      currY += fontSize;
+  layout.m_truncated = false;
+  if (style.maxLines > 0 && lines.size() > style.maxLines) {
+    lines.resize(style.maxLines);
+    lines.back().ellipsis = style.ellipsis;
+    layout.m_truncated = true;
+  }
+
+  // U+2026 if the fonts have it, three dots otherwise
+  std::vector<u32> ellipsis(1, 0x2026);
+  if (this->m_fontMetrics.get(0x2026).index == 0)
+    ellipsis.assign(3, '.');
+
+  u32 ellipsisWidth = 0;
+  for (const u32 codepoint : ellipsis)
+    ellipsisWidth += glyphAdvance(this->m_fontMetrics, codepoint, fontSize);
 
+  for (Line& line : lines) {
+    const bool overflows = style.maxWidth > 0 && line.width > style.maxWidth;
+    if (!overflows && !line.ellipsis)
       continue;
+
+    line.ellipsis = style.ellipsis;
+    layout.m_truncated = true;
+
+    // Drop codepoints until the rest and the ellipsis fit
+    u32 limit = line.width;
+    if (style.maxWidth > 0) {
+      limit = style.maxWidth;
+      if (line.ellipsis)
+        limit -= std::min(limit, ellipsisWidth);
     }
 
-    if (!std::iswspace(currCharacter) && fontSize > 0 && color.a != 0x0)
-      this->drawGlyph(currCharacter,
-                      currX + bounds[0],
-                      currY + bounds[1],
-                      color,
-                      currFont,
-                      currFontSize);
+    while (line.end > line.begin
+           && (line.width > limit || isSpace(codepoints[line.end - 1])))
+      line.width -= advances[--line.end];
 
-    currX += xAdvance * currFontSize;
+    if (line.ellipsis)
+      line.width += ellipsisWidth;
+  }
 
-  } while (i < stringLength);
+  u32 boxWidth = style.maxWidth;
+  if (boxWidth == 0)
+    for (const Line& line : lines)
+      boxWidth = std::max(boxWidth, line.width);
+
+  layout.m_glyphs.clear();
+  layout.m_width = 0;
+
+  std::vector<u32> lineCodepoints;
+  for (u32 i = 0; i < lines.size(); i++) {
+    const Line& line = lines[i];
+
+    lineCodepoints.assign(codepoints.begin() + line.begin,
+                          codepoints.begin() + line.end);
+    if (line.ellipsis)
+      lineCodepoints.insert(
+          lineCodepoints.end(), ellipsis.begin(), ellipsis.end());
+
+    const u32 free = boxWidth - std::min(boxWidth, line.width);
+    u32 offset = 0;
+    if (style.alignment == TextAlignment::Center)
+      offset = free / 2;
+    else if (style.alignment == TextAlignment::Right)
+      offset = free;
+
+    const u32 lineWidth =
+        shapeString(
+            this->m_fontMetrics,
+            lineCodepoints,
+            false,
+            offset,
+            i * fontSize,
+            fontSize,
+            [&](u32 codepoint, s32 x, s32 y, stbtt_fontinfo* font, float scale)
+            { layout.m_glyphs.push_back({codepoint, x, y, font, scale}); })
+            .first;
+
+    layout.m_width = std::max(layout.m_width, offset + lineWidth);
+  }
 
-  maxX = std::max(currX, maxX);
+  // Same as drawString, the distance between the first and last line
+  layout.m_height = (lines.size() - 1) * fontSize;
+  layout.m_lineCount = lines.size();
 
-  return {maxX - x, currY - y};
+  layout.m_valid = true;
+  layout.m_paragraph = true;
+  layout.m_text = string;
+  layout.m_fontSize = fontSize;
+  layout.m_style = style;
+}
+
+void Renderer::drawLayout(const TextLayout& layout, s32 x, s32 y, Color color)
+{
+  if (color.a == 0x0)
+    return;
+
+  for (const auto& glyph : layout.getGlyphs())
+    this->drawGlyph(glyph.codepoint,
+                    x + glyph.x,
+                    y + glyph.y,
+                    color,
+                    glyph.font,
+                    glyph.scale);
+}
+
+void Renderer::renderScrollingText(ScrollingText& text,
+                                   std::string_view string,
+                                   float fontSize)
+{
+  if (text.m_valid && text.m_text == string && text.m_fontSize == fontSize)
+    return;
+
+  TextLayout layout;
+  this->layoutString(layout, string, false, fontSize);
+
+  // Glyph boxes may reach past the pen positions the layout is measured with
+  s32 left = 0, top = 0, right = layout.getWidth(), bottom = 0;
+  std::vector<const GlyphCache::Glyph*> glyphs;
+
+  for (const auto& glyph : layout.getGlyphs()) {
+    const GlyphCache::Glyph& bitmap =
+        this->m_glyphCache.get(glyph.font, glyph.codepoint, glyph.scale);
+
+    left = std::min(left, glyph.x);
+    top = std::min(top, glyph.y);
+    right = std::max(right, glyph.x + bitmap.width);
+    bottom = std::max(bottom, glyph.y + bitmap.height);
+  }
+
+  text.m_width = layout.getWidth();
+  text.m_stride = right - left + text.m_width + ScrollingText::Gap;
+  text.m_height = bottom - top;
+  text.m_left = left;
+  text.m_top = top;
+  text.m_coverage.assign(text.m_stride * text.m_height, 0);
+
+  for (const u32 repeat : {0U, text.m_width + ScrollingText::Gap}) {
+    for (const auto& glyph : layout.getGlyphs()) {
+      // Looked up again, a glyph may get evicted by the ones drawn after it
+      const GlyphCache::Glyph& bitmap =
+          this->m_glyphCache.get(glyph.font, glyph.codepoint, glyph.scale);
+      if (bitmap.coverage == nullptr)
+        continue;
+
+      const u32 packedStride = (bitmap.width + 1) / 2;
+      u8* dst = text.m_coverage.data() + (glyph.y - top) * text.m_stride
+          + (glyph.x - left) + repeat;
+
+      // Glyphs may overlap, keep the stronger coverage
+      for (u32 row = 0; row < bitmap.height; row++, dst += text.m_stride)
+        for (u32 col = 0; col < bitmap.width; col++) {
+          const u8 packed = bitmap.coverage[row * packedStride + col / 2];
+          dst[col] = std::max<u8>(dst[col], (packed >> (col & 1) * 4) & 0xF);
+        }
+    }
+  }
+
+  text.m_text = string;
+  text.m_fontSize = fontSize;
+  text.m_valid = true;
+}
+
+void Renderer::drawScrollingText(
+    const ScrollingText& text, s32 x, s32 y, u32 width, Color color)
+{
+  if (!text.m_valid || text.m_coverage.empty() || color.a == 0x0)
+    return;
+
+  // The strip starts left of the pen when the first glyph overhangs it
+  const s32 offset = text.getOffset();
+  const s32 first = std::max(offset - text.m_left, 0);
+  const s32 last =
+      std::min<s32>(offset + width - text.m_left, text.m_stride);
+  if (first >= last)
+    return;
+
+  this->drawCoverage(x + text.m_left + first - offset,
+                     y + text.m_top,
+                     last - first,
+                     text.m_height,
+                     text.m_coverage.data() + first,
+                     text.m_stride,
+                     color);
+}
+
+void Renderer::prewarmGlyphs(std::string_view string, float fontSize)
+{
+  // Distance fields are rendered per size on the render thread
+  if (fontSize <= 0 || this->m_glyphCache.getDistanceFields() != nullptr)
+    return;
+
+  // Without a worker the glyphs get rasterized when they're drawn
+  if (!this->m_glyphPrewarmer.start())
+    return;
+
+  decodeUtf8(string, this->m_codepoints);
+
+  for (const u32 codepoint : this->m_codepoints) {
+    if (isSpace(codepoint))
+      continue;
+
+    // Same font and scale drawString resolves the codepoint to
+    const FontMetrics::Font& font = *this->m_fontMetrics.get(codepoint).font;
+    const float scale = font.getScale(fontSize);
+
+    if (!this->m_glyphCache.contains(font.info, codepoint, scale))
+      this->m_glyphPrewarmer.schedule({font.info, codepoint, scale});
+  }
+}
+
+const GlyphCache::Stats& Renderer::getGlyphCacheStats() const
+{
+  return this->m_glyphCache.getStats();
+}
+
+void Renderer::resetGlyphCacheStats()
+{
+  this->m_glyphCache.resetStats();
+}
+
+void Renderer::addDamage(s32 x, s32 y, s32 w, s32 h)
+{
+  s32 x0 = std::max<s32>(x, 0);
+  s32 y0 = std::max<s32>(y, 0);
+  s32 x1 = std::min<s32>(x + w, cfg::FramebufferWidth);
+  s32 y1 = std::min<s32>(y + h, cfg::FramebufferHeight);
+
+  if (x0 >= x1 || y0 >= y1)
+    return;
+
+  auto& damage = this->m_pendingDamage;
+  if (damage[0] >= damage[2] || damage[1] >= damage[3]) {
+    damage[0] = x0;
+    damage[1] = y0;
+    damage[2] = x1;
+    damage[3] = y1;
+  } else {
+    damage[0] = std::min(damage[0], x0);
+    damage[1] = std::min(damage[1], y0);
+    damage[2] = std::max(damage[2], x1);
+    damage[3] = std::max(damage[3], y1);
+  }
+}
+
+void Renderer::addFullDamage()
+{
+  this->addDamage(0, 0, cfg::FramebufferWidth, cfg::FramebufferHeight);
+}
+
+bool Renderer::isDamaged(s32 x, s32 y, s32 w, s32 h) const
+{
+  return x < this->m_frameDamage[2] && y < this->m_frameDamage[3]
+      && x + w > this->m_frameDamage[0] && y + h > this->m_frameDamage[1];
+}
+
+const Renderer::RedrawStats& Renderer::getRedrawStats() const
+{
+  return this->m_redrawStats;
+}
+
+void Renderer::resetRedrawStats()
+{
+  this->m_redrawStats = {};
+}
+
+const FramePacer::Stats& Renderer::getFrameStats() const
+{
+  return this->m_framePacer.getStats();
+}
+
+void Renderer::resetFrameStats()
+{
+  this->m_framePacer.resetStats();
 }
 
 Renderer& Renderer::get()
@@ -383,6 +1503,10 @@ void Renderer::setOpacity(float opacity)
 {
   opacity = std::clamp(opacity, 0.0F, 1.0F);
 
+  // Every drawn color depends on the opacity
+  if (opacity != Renderer::s_opacity)
+    Renderer::get().addFullDamage();
+
   Renderer::s_opacity = opacity;
 }
 
@@ -391,6 +1515,28 @@ void* Renderer::getCurrentFramebuffer()
   return this->m_currentFramebuffer;
 }
 
+void* Renderer::getRenderTarget()
+{
+  if (this->m_canvas != nullptr)
+    return this->m_canvas->m_pixels.data();
+
+  if (this->m_linear)
+    return this->m_linearBuffer.data();
+
+  return this->m_currentFramebuffer;
+}
+
+size_t Renderer::getRenderTargetSize()
+{
+  if (this->m_canvas != nullptr)
+    return this->m_canvas->m_pixels.size() * sizeof(u16);
+
+  if (this->m_linear)
+    return this->m_linearBuffer.size() * sizeof(u16);
+
+  return this->getFramebufferSize();
+}
+
 void* Renderer::getNextFramebuffer()
 {
   return static_cast<u8*>(this->m_framebuffer.buf)
@@ -424,21 +1570,405 @@ void Renderer::waitForVSync()
 
 const u32 Renderer::getPixelOffset(u32 x, u32 y)
 {
-  if (this->m_scissoring) {
-    if (x < this->m_scissorBounds[0] || y < this->m_scissorBounds[1]
-        || x > this->m_scissorBounds[0] + this->m_scissorBounds[2]
-        || y > this->m_scissorBounds[1] + this->m_scissorBounds[3])
-      return cfg::FramebufferWidth * cfg::FramebufferHeight * 2 + 1;
+  return this->m_rowOffsets[y] + this->m_columnOffsets[x];
+}
+
+u32 Renderer::getBlockLinearOffset(u32 x, u32 y)
+{
+  return this->m_swizzleRowOffsets[y] + this->m_swizzleColumnOffsets[x];
+}
+
+void Renderer::initSwizzleTables()
+{
+  // The block linear offset splits into a part that only depends on y and a
+  // part that only depends on x. Both are in pixels, a block of 32x16 pixels
+  // takes up 512 of them
+  const u32 blocksPer128Rows = (cfg::FramebufferWidth / 2) / 16 * 8;
+
+  this->m_swizzleRowOffsets.resize(cfg::FramebufferHeight);
+  for (u32 y = 0; y < cfg::FramebufferHeight; y++)
+    this->m_swizzleRowOffsets[y] =
+        (((y & 127) / 16) + (y / 128) * blocksPer128Rows) * 512
+        + ((y % 16) / 8) * 256 + ((y % 8) / 2) * 32 + (y % 2) * 8;
+
+  this->m_swizzleColumnOffsets.resize(cfg::FramebufferWidth);
+  for (u32 x = 0; x < cfg::FramebufferWidth; x++)
+    this->m_swizzleColumnOffsets[x] = (x / 32) * 8 * 512
+        + ((x % 32) / 16) * 128 + ((x % 16) / 8) * 16 + (x % 8);
+
+  this->m_clipStack.assign(
+      1, {0, 0, cfg::FramebufferWidth, cfg::FramebufferHeight});
+
+  this->m_blockColumns = (cfg::FramebufferWidth + 31) / 32;
+  this->m_dirtyBlocks.assign((cfg::FramebufferHeight + 15) / 16, 0);
+
+  this->setLinearRendering(false);
+
+  this->m_tileColumns = (cfg::FramebufferWidth + TileWidth - 1) / TileWidth;
+  this->m_tileCommands.resize(
+      this->m_tileColumns
+      * ((cfg::FramebufferHeight + TileHeight - 1) / TileHeight));
+}
+
+void Renderer::setLinearRendering(bool linear)
+{
+  this->m_linear = linear;
+
+  if (linear) {
+    this->m_linearStride = this->m_blockColumns * 32;
+    this->m_linearBuffer.assign(
+        this->m_linearStride * this->m_dirtyBlocks.size() * 16, 0);
+
+    this->m_rowOffsets.resize(cfg::FramebufferHeight);
+    for (u32 y = 0; y < cfg::FramebufferHeight; y++)
+      this->m_rowOffsets[y] = y * this->m_linearStride;
+
+    this->m_columnOffsets.resize(cfg::FramebufferWidth);
+    for (u32 x = 0; x < cfg::FramebufferWidth; x++)
+      this->m_columnOffsets[x] = x;
+  } else {
+    std::vector<u16>().swap(this->m_linearBuffer);
+
+    this->m_rowOffsets = this->m_swizzleRowOffsets;
+    this->m_columnOffsets = this->m_swizzleColumnOffsets;
+  }
+
+  // Neither buffer holds the image of the other one
+  this->addFullDamage();
+}
+
+void Renderer::swizzleDirtyBlocks()
+{
+  const u16* linear = this->m_linearBuffer.data();
+  u16* framebuffer = static_cast<u16*>(this->getCurrentFramebuffer());
+
+  // A block row of 32 pixels is stored as 4 runs of 8, so every run is a
+  // single 16 byte load and store
+  for (u32 row = 0; row < this->m_dirtyBlocks.size(); row++) {
+    const u32 y1 = std::min<u32>(row * 16 + 16, cfg::FramebufferHeight);
+
+    for (u64 columns = this->m_dirtyBlocks[row]; columns != 0;
+         columns &= columns - 1)
+    {
+      const u32 x0 = std::countr_zero(columns) * 32;
+      const u32 x1 = std::min<u32>(x0 + 32, cfg::FramebufferWidth);
+
+      for (u32 y = row * 16; y < y1; y++) {
+        const u16* src = linear + y * this->m_linearStride;
+        u16* dst = framebuffer + this->m_swizzleRowOffsets[y];
+
+        for (u32 x = x0; x < x1; x += 8)
+          std::memcpy(
+              dst + this->m_swizzleColumnOffsets[x], src + x, 8 * sizeof(u16));
+      }
+    }
+  }
+}
+
+bool Renderer::clipRect(s32& x0, s32& y0, s32& x1, s32& y1)
+{
+  x0 = std::max<s32>(x0, this->m_frameDamage[0]);
+  y0 = std::max<s32>(y0, this->m_frameDamage[1]);
+  x1 = std::min<s32>(x1, this->m_frameDamage[2]);
+  y1 = std::min<s32>(y1, this->m_frameDamage[3]);
+
+  const auto& clip = this->m_clipStack.back();
+  x0 = std::max(x0, clip[0]);
+  y0 = std::max(y0, clip[1]);
+  x1 = std::min(x1, clip[2]);
+  y1 = std::min(y1, clip[3]);
+
+  if (t_tile.active) {
+    x0 = std::max(x0, t_tile.clip[0]);
+    y0 = std::max(y0, t_tile.clip[1]);
+    x1 = std::min(x1, t_tile.clip[2]);
+    y1 = std::min(y1, t_tile.clip[3]);
+  }
+
+  if (x0 >= x1 || y0 >= y1)
+    return false;
+
+  this->markBlocksDirty(x0, y0, x1, y1);
+
+  return true;
+}
+
+bool Renderer::isOutsideFrame(s32 x, s32 y) const
+{
+  if (t_tile.active
+      && (x < t_tile.clip[0] || y < t_tile.clip[1] || x >= t_tile.clip[2]
+          || y >= t_tile.clip[3]))
+    return true;
+
+  const auto& clip = this->m_clipStack.back();
+
+  return x < this->m_frameDamage[0] || y < this->m_frameDamage[1]
+      || x >= this->m_frameDamage[2] || y >= this->m_frameDamage[3]
+      || x < clip[0] || y < clip[1] || x >= clip[2] || y >= clip[3];
+}
+
+void Renderer::markBlocksDirty(s32 x0, s32 y0, s32 x1, s32 y1)
+{
+  // Recorded calls mark their blocks when they get recorded, canvases aren't
+  // part of the framebuffer
+  if (t_tile.active || this->m_canvas != nullptr)
+    return;
+
+  const u64 columns = (~0ULL >> (63 - (x1 - 1) / 32)) & (~0ULL << (x0 / 32));
+
+  for (s32 row = y0 / 16; row <= (y1 - 1) / 16; row++)
+    this->m_dirtyBlocks[row] |= columns;
+}
+
+void Renderer::copyDirtyBlocks()
+{
+  u32 dirtyCount = 0;
+
+  for (u64 columns : this->m_dirtyBlocks)
+    dirtyCount += std::popcount(columns);
+
+  if (dirtyCount == 0)
+    return;
+
+  this->m_redrawStats.copiedBlocks += dirtyCount;
+
+  if (dirtyCount == this->m_dirtyBlocks.size() * this->m_blockColumns) {
+    std::memcpy(this->getNextFramebuffer(),
+                this->getCurrentFramebuffer(),
+                this->getFramebufferSize());
+  } else {
+    const u16* current = static_cast<u16*>(this->getCurrentFramebuffer());
+    u16* next = static_cast<u16*>(this->getNextFramebuffer());
+
+    // Every 32x16 block is 512 pixels stored next to each other
+    for (u32 row = 0; row < this->m_dirtyBlocks.size(); row++) {
+      const u32 rowOffset = this->m_swizzleRowOffsets[row * 16];
+
+      for (u64 columns = this->m_dirtyBlocks[row]; columns != 0;
+           columns &= columns - 1)
+      {
+        const u32 offset = rowOffset
+            + this->m_swizzleColumnOffsets[std::countr_zero(columns) * 32];
+        std::memcpy(next + offset, current + offset, 512 * sizeof(u16));
+      }
+    }
+  }
+
+  std::fill(this->m_dirtyBlocks.begin(), this->m_dirtyBlocks.end(), 0);
+}
+
+void Renderer::fillSpans(s32 x0, s32 y0, s32 x1, s32 y1, Color color)
+{
+  u16* framebuffer = static_cast<u16*>(this->getRenderTarget());
+
+  for (s32 y = y0; y < y1; y++)
+    forEachRun(framebuffer + this->m_rowOffsets[y],
+               this->m_columnOffsets,
+               this->m_linear,
+               x0,
+               x1,
+               [color](u16* run, s32, s32 length)
+               { blend::fill(run, length, color); });
+}
+
+void Renderer::blendCoverage(
+    s32 y, s32 x0, s32 x1, const u8* coverage, Color color)
+{
+  u16* row = static_cast<u16*>(this->getRenderTarget()) + this->m_rowOffsets[y];
+
+  // Split into runs that are either fully covered or not
+  for (s32 x = x0; x < x1;) {
+    const bool full = coverage[x - x0] == 0xFF;
+
+    s32 next = x + 1;
+    while (next < x1 && (coverage[next - x0] == 0xFF) == full)
+      next++;
+
+    if (full)
+      forEachRun(row,
+                 this->m_columnOffsets,
+                 this->m_linear,
+                 x,
+                 next,
+                 [color](u16* run, s32, s32 length)
+                 { blend::fill(run, length, color); });
+    else
+      forEachRun(row,
+                 this->m_columnOffsets,
+                 this->m_linear,
+                 x,
+                 next,
+                 [&](u16* run, s32 runX, s32 length)
+                 { blend::mask(run, coverage + (runX - x0), length, color); });
+
+    x = next;
+  }
+}
+
+bool Renderer::isRecording() const
+{
+  return this->m_recording && !t_tile.active;
+}
+
+bool Renderer::record(DrawCommand command, s32 x0, s32 y0, s32 x1, s32 y1)
+{
+  // fillScreen ignores the clip rect
+  if (command.type != DrawCommand::Type::Fill)
+    std::copy_n(this->m_clipStack.back().begin(), 4, command.clip);
+  else
+    std::copy_n(this->m_clipStack.front().begin(), 4, command.clip);
+
+  x0 = std::max({x0, command.clip[0], this->m_frameDamage[0]});
+  y0 = std::max({y0, command.clip[1], this->m_frameDamage[1]});
+  x1 = std::min({x1, command.clip[2], this->m_frameDamage[2]});
+  y1 = std::min({y1, command.clip[3], this->m_frameDamage[3]});
+
+  if (x0 >= x1 || y0 >= y1)
+    return false;
+
+  this->markBlocksDirty(x0, y0, x1, y1);
+
+  const u32 index = this->m_commands.size();
+  this->m_commands.push_back(command);
+
+  for (s32 row = y0 / TileHeight; row <= (y1 - 1) / TileHeight; row++)
+    for (s32 column = x0 / TileWidth; column <= (x1 - 1) / TileWidth; column++)
+      this->m_tileCommands[row * this->m_tileColumns + column].push_back(index);
+
+  return true;
+}
+
+void Renderer::execute(const DrawCommand& command)
+{
+  const s32* args = command.args;
+
+  switch (command.type) {
+    case DrawCommand::Type::Pixel:
+      this->setPixel(args[0], args[1], command.color);
+      break;
+    case DrawCommand::Type::PixelBlendSrc:
+      this->setPixelBlendSrc(args[0], args[1], command.color);
+      break;
+    case DrawCommand::Type::PixelBlendDst:
+      this->setPixelBlendDst(args[0], args[1], command.color);
+      break;
+    case DrawCommand::Type::Rect:
+      this->drawRect(args[0], args[1], args[2], args[3], command.color);
+      break;
+    case DrawCommand::Type::RoundedRect:
+      this->drawRoundedRect(
+          args[0], args[1], args[2], args[3], args[4], command.color);
+      break;
+    case DrawCommand::Type::Arc:
+      this->drawArc(args[0],
+                    args[1],
+                    args[2],
+                    args[3],
+                    args[4],
+                    args[5],
+                    command.color);
+      break;
+    case DrawCommand::Type::Gradient:
+      this->drawGradientRect(args[0],
+                             args[1],
+                             args[2],
+                             args[3],
+                             command.color,
+                             static_cast<u16>(command.data),
+                             args[4]);
+      break;
+    case DrawCommand::Type::Line:
+      this->drawLine(args[0], args[1], args[2], args[3], command.color);
+      break;
+    case DrawCommand::Type::AntiAliasedLine:
+      this->drawAntiAliasedLine(
+          args[0], args[1], args[2], args[3], command.color);
+      break;
+    case DrawCommand::Type::DashedLine:
+      this->drawDashedLine(
+          args[0], args[1], args[2], args[3], args[4], command.color);
+      break;
+    case DrawCommand::Type::Bitmap:
+      this->drawBitmap(args[0],
+                       args[1],
+                       args[2],
+                       args[3],
+                       this->m_commandData.data() + command.data);
+      break;
+    case DrawCommand::Type::Image:
+      this->drawImage(
+          args[0], args[1], *this->m_commandImages[command.data]);
+      break;
+    case DrawCommand::Type::Glyph:
+      this->blitGlyph({0,
+                       0,
+                       static_cast<u16>(args[2]),
+                       static_cast<u16>(args[3]),
+                       this->m_commandData.data() + command.data},
+                      args[0],
+                      args[1],
+                      command.color);
+      break;
+    case DrawCommand::Type::Coverage:
+      this->drawCoverage(args[0],
+                         args[1],
+                         args[2],
+                         args[3],
+                         this->m_commandData.data() + command.data,
+                         args[2],
+                         command.color);
+      break;
+    case DrawCommand::Type::Fill:
+      this->fillScreen(command.color);
+      break;
   }
+}
+
+void Renderer::rasterizeTiles()
+{
+  for (u32 tile = 0; tile < this->m_tileCommands.size(); tile++)
+    if (!this->m_tileCommands[tile].empty())
+      this->m_activeTiles.push_back(tile);
+
+  // Commands carry their own clip rect
+  this->m_clipStack.push_back(this->m_clipStack.front());
+
+  // A tile is only ever touched by one thread, which replays the commands in
+  // the order they were recorded, so every pixel sees the same operations as
+  // when drawing right away
+  this->m_workerPool.run(
+      this->m_activeTiles.size(),
+      [this](u32 i)
+      {
+        const u32 tile = this->m_activeTiles[i];
+        const s32 tileX = (tile % this->m_tileColumns) * TileWidth;
+        const s32 tileY = (tile / this->m_tileColumns) * TileHeight;
+
+        t_tile.active = true;
+
+        for (u32 index : this->m_tileCommands[tile]) {
+          const DrawCommand& command = this->m_commands[index];
 
-  u32 tmpPos = ((y & 127) / 16) + (x / 32 * 8)
-      + ((y / 16 / 8) * (((cfg::FramebufferWidth / 2) / 16 * 8)));
-  tmpPos *= 16 * 16 * 4;
+          t_tile.clip[0] = std::max(tileX, command.clip[0]);
+          t_tile.clip[1] = std::max(tileY, command.clip[1]);
+          t_tile.clip[2] = std::min(tileX + TileWidth, command.clip[2]);
+          t_tile.clip[3] = std::min(tileY + TileHeight, command.clip[3]);
 
-  tmpPos += ((y % 16) / 8) * 512 + ((x % 32) / 16) * 256 + ((y % 8) / 2) * 64
-      + ((x % 16) / 8) * 32 + (y % 2) * 16 + (x % 8) * 2;
+          this->execute(command);
+        }
 
-  return tmpPos / 2;
+        t_tile.active = false;
+      });
+
+  this->m_clipStack.pop_back();
+
+  for (u32 tile : this->m_activeTiles)
+    this->m_tileCommands[tile].clear();
+
+  this->m_activeTiles.clear();
+  this->m_commands.clear();
+  this->m_commandData.clear();
+  this->m_commandImages.clear();
 }
 
 void Renderer::init()
@@ -504,6 +2034,18 @@ void Renderer::init()
         ASSERT_FATAL(this->initFonts());
       });
 
+  this->initSwizzleTables();
+  this->m_glyphCache.setCapacity(glyphCacheSize);
+  this->m_sdfGlyphCache.setCapacity(glyphCacheSize);
+  pinBakedGlyphs(this->m_glyphCache, this->m_fontMetrics);
+
+  // Glyphs rasterized by earlier launches of any overlay
+  const stbtt_fontinfo* const fonts[] = {&this->m_extFont, &this->m_stdFont};
+  if (glyphCacheFile != nullptr)
+    this->m_glyphCache.load(glyphCacheFile, fonts, this->getGlyphCacheKey());
+  this->addFullDamage();
+  this->m_framePacer.onFrameStart();
+
   this->m_initialized = true;
 }
 
@@ -512,6 +2054,14 @@ void Renderer::exit()
   if (!this->m_initialized)
     return;
 
+  this->m_workerPool.stop();
+  this->m_requestedWorkers = 0;
+  this->m_glyphPrewarmer.stop();
+
+  const stbtt_fontinfo* const fonts[] = {&this->m_extFont, &this->m_stdFont};
+  if (glyphCacheFile != nullptr && this->m_glyphCache.isModified())
+    this->m_glyphCache.save(glyphCacheFile, fonts, this->getGlyphCacheKey());
+
   framebufferClose(&this->m_framebuffer);
   nwindowClose(&this->m_window);
   viDestroyManagedLayer(&this->m_layer);
@@ -544,24 +2094,97 @@ Result Renderer::initFonts()
   stbtt_InitFont(
       &this->m_extFont, fontBuffer, stbtt_GetFontOffsetForIndex(fontBuffer, 0));
 
+  this->m_fontMetrics.setFonts(&this->m_stdFont, &this->m_extFont);
+
   return res;
 }
 
+u32 Renderer::getGlyphCacheKey() const
+{
+  const u32 fingerprints[] = {fingerprintFont(&this->m_extFont),
+                              fingerprintFont(&this->m_stdFont)};
+
+  // Glyphs may be rasterized differently by another version
+  u32 hash = 0x811C9DC5;
+  for (const u32 fingerprint : fingerprints)
+    for (u32 shift = 0; shift < 32; shift += 8)
+      hash = (hash ^ u8(fingerprint >> shift)) * 0x01000193;
+  for (const char* c = NIKOLA_VERSION; *c != '\0'; c++)
+    hash = (hash ^ u8(*c)) * 0x01000193;
+
+  return hash;
+}
+
 void Renderer::startFrame()
 {
+  this->m_framePacer.configure(framePacing, TeslaFPS);
+
+  // The thread calling endFrame rasterizes tiles as well. Compared with what
+  // was asked for, a pool missing threads that failed to start stays as it is
+  const u32 workers = std::max<u32>(renderThreads, 1) - 1;
+  if (this->m_requestedWorkers != workers) {
+    this->m_workerPool.start(workers);
+    this->m_requestedWorkers = workers;
+  }
+  this->m_recording = workers != 0;
+
   this->m_currentFramebuffer = framebufferBegin(&this->m_framebuffer, nullptr);
+
+  if (linearRendering != this->m_linear)
+    this->setLinearRendering(linearRendering);
+
+  // Glyphs look slightly different either way, redraw all text consistently
+  if (SdfGlyphCache* fields = sdfText ? &this->m_sdfGlyphCache : nullptr;
+      this->m_glyphCache.getDistanceFields() != fields) {
+    this->m_glyphCache.setDistanceFields(fields);
+    this->addFullDamage();
+  }
+
+  this->m_glyphPrewarmer.collect(this->m_glyphCache);
+
+  if (!partialRedraw)
+    this->addFullDamage();
+
+  std::copy_n(this->m_pendingDamage, 4, this->m_frameDamage);
+  std::fill_n(this->m_pendingDamage, 4, 0);
+
+  const auto& [x0, y0, x1, y1] = this->m_frameDamage;
+  const u32 pixels = x0 < x1 && y0 < y1 ? (x1 - x0) * (y1 - y0) : 0;
+
+  this->m_redrawStats.frames++;
+  this->m_redrawStats.redrawnFrames += pixels > 0;
+  this->m_redrawStats.redrawnPixels += pixels;
+  this->m_redrawStats.lastRedrawnPixels = pixels;
 }
 
 void Renderer::endFrame()
 {
-  std::memcpy(this->getNextFramebuffer(),
-              this->getCurrentFramebuffer(),
-              this->getFramebufferSize());
-  svcSleepThread(1000 * 1000 * 1000 / TeslaFPS);
-  this->waitForVSync();
+  if (this->m_recording) {
+    this->rasterizeTiles();
+    this->m_recording = false;
+  }
+
+  if (this->m_linear)
+    this->swizzleDirtyBlocks();
+
+  this->copyDirtyBlocks();
+
+  const auto present = this->m_framePacer.onFrameEnd();
+  if (present.sleep > 0)
+    svcSleepThread(present.sleep);
+  for (u32 i = 0; i < present.vsyncs; i++)
+    this->waitForVSync();
+
   framebufferEnd(&this->m_framebuffer);
+  this->m_framePacer.onPresented();
 
   this->m_currentFramebuffer = nullptr;
+
+  // Input and updates for the next frame happen after this returns, so any
+  // low latency delay has to be spent here
+  if (const u64 delay = this->m_framePacer.getStartDelay(); delay > 0)
+    svcSleepThread(delay);
+  this->m_framePacer.onFrameStart();
 }
 
 void Renderer::drawGlyph(s32 codepoint,
@@ -571,24 +2194,111 @@ void Renderer::drawGlyph(s32 codepoint,
                          stbtt_fontinfo* font,
                          float fontSize)
 {
-  int width = 10, height = 10;
+  const GlyphCache::Glyph& glyph =
+      this->m_glyphCache.get(font, codepoint, fontSize);
+
+  if (glyph.coverage == nullptr)
+    return;
+
+  if (this->isRecording()) {
+    // Cached glyphs may get evicted before the frame gets rasterized
+    const u32 data = this->m_commandData.size();
+    if (this->record({DrawCommand::Type::Glyph,
+                      color,
+                      {x, y, glyph.width, glyph.height},
+                      data},
+                     x,
+                     y,
+                     x + glyph.width,
+                     y + glyph.height))
+      this->m_commandData.insert(this->m_commandData.end(),
+                                 glyph.coverage,
+                                 glyph.coverage
+                                     + (glyph.width + 1) / 2 * glyph.height);
+    return;
+  }
+
+  this->blitGlyph(glyph, x, y, color);
+}
 
-  u8* glyphBmp = stbtt_GetCodepointBitmap(
-      font, fontSize, fontSize, codepoint, &width, &height, nullptr, nullptr);
+void Renderer::blitGlyph(const GlyphCache::Glyph& glyph,
+                         s32 x,
+                         s32 y,
+                         Color color)
+{
+  s32 x0 = x, y0 = y, x1 = x + glyph.width, y1 = y + glyph.height;
 
-  if (glyphBmp == nullptr)
+  if (!this->clipRect(x0, y0, x1, y1))
     return;
 
-  for (s16 bmpY = 0; bmpY < height; bmpY++) {
-    for (s16 bmpX = 0; bmpX < width; bmpX++) {
-      Color tmpColor = color;
-      tmpColor.a =
-          (glyphBmp[width * bmpY + bmpX] >> 4) * (float(tmpColor.a) / 0xF);
-      this->setPixelBlendSrc(x + bmpX, y + bmpY, tmpColor);
+  // Text is mostly drawn in a handful of colors, so the table rarely changes
+  if (t_coverageTable.color.rgba != color.rgba)
+    t_coverageTable.build(color);
+
+  u16* framebuffer = static_cast<u16*>(this->getRenderTarget());
+  const u32 stride = (glyph.width + 1) / 2;
+  const s32 left = x0 - x, right = x1 - x;
+  u8 coverage[cfg::LayerMaxWidth];
+
+  for (s32 bmpY = y0; bmpY < y1; bmpY++) {
+    const u8* packed = glyph.coverage + stride * (bmpY - y);
+
+    // Unpack the visible part of the row and skip it if it's empty
+    u8 any = 0;
+    for (s32 bmpX = left; bmpX < right; bmpX++) {
+      const u8 value = (packed[bmpX / 2] >> (bmpX & 1 ? 4 : 0)) & 0xF;
+      coverage[bmpX - left] = value;
+      any |= value;
     }
+
+    if (any == 0)
+      continue;
+
+    // Only blend the runs of pixels the glyph covers at all
+    blendCoverageRuns(framebuffer + this->m_rowOffsets[bmpY],
+                      this->m_columnOffsets,
+                      this->m_linear,
+                      x0,
+                      x1,
+                      coverage);
   }
+}
+
+void Renderer::drawCoverage(
+    s32 x, s32 y, s32 w, s32 h, const u8* coverage, u32 stride, Color color)
+{
+  if (this->isRecording()) {
+    // Copied so the command doesn't depend on the caller's buffer
+    const u32 data = this->m_commandData.size();
+    if (this->record({DrawCommand::Type::Coverage, color, {x, y, w, h}, data},
+                     x,
+                     y,
+                     x + w,
+                     y + h))
+      for (s32 row = 0; row < h; row++)
+        this->m_commandData.insert(this->m_commandData.end(),
+                                   coverage + row * stride,
+                                   coverage + row * stride + w);
+    return;
+  }
+
+  s32 x0 = x, y0 = y, x1 = x + w, y1 = y + h;
+
+  if (!this->clipRect(x0, y0, x1, y1))
+    return;
+
+  if (t_coverageTable.color.rgba != color.rgba)
+    t_coverageTable.build(color);
+
+  u16* framebuffer = static_cast<u16*>(this->getRenderTarget());
 
-  std::free(glyphBmp);
+  for (s32 row = y0; row < y1; row++)
+    blendCoverageRuns(framebuffer + this->m_rowOffsets[row],
+                      this->m_columnOffsets,
+                      this->m_linear,
+                      x0,
+                      x1,
+                      coverage + (row - y) * stride + (x0 - x));
 }
 
 void Renderer::setLayerPosImpl(u16 x, u16 y)
@@ -0,0 +1,448 @@
+//
+// Created by pugemon on 16.10.26.
+//
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <switch.h>
+
+#include "nikola/tesla/glyph_cache.hpp"
+#include "nikola/tesla/sdf_glyph_cache.hpp"
+
+namespace tsl::gfx
+{
+
+namespace
+{
+
+constexpr u32 InvalidSlot = UINT32_MAX;
+
+/**
+ * @brief Header of a glyph cache file, followed by the glyph records and then
+ * the coverage of all glyphs
+ */
+struct FileHeader
+{
+  char magic[4];
+  u8 version;
+  u8 reserved[3];
+  u32 key;  ///< Key the file was saved with
+  u32 glyphCount;
+  u32 dataSize;  ///< Bytes of coverage following the glyph records
+};
+
+/**
+ * @brief A glyph inside a glyph cache file
+ */
+struct FileGlyph
+{
+  u32 codepoint;
+  float scale;
+  u8 font;  ///< Index into the fonts passed to save and load
+  u8 reserved[3];
+  s16 xOffset, yOffset;
+  u16 width, height;
+  u32 offset;  ///< Offset of the coverage from the start of the coverage
+};
+
+static_assert(sizeof(FileHeader) == 20);
+static_assert(sizeof(FileGlyph) == 24);
+
+constexpr char FileMagic[4] = {'N', 'K', 'G', 'C'};
+constexpr u8 FileVersion = 1;
+
+}  // namespace
+
+bool GlyphCache::Key::operator==(const Key& other) const
+{
+  return this->font == other.font && this->codepoint == other.codepoint
+      && std::bit_cast<u32>(this->scale) == std::bit_cast<u32>(other.scale);
+}
+
+size_t GlyphCache::KeyHash::operator()(const Key& key) const
+{
+  const u64 hash = reinterpret_cast<uintptr_t>(key.font) * 0x9E3779B97F4A7C15
+      ^ (u64(std::bit_cast<u32>(key.scale)) << 21) ^ key.codepoint;
+
+  return std::hash<u64> {}(hash);
+}
+
+void GlyphCache::setCapacity(size_t bytes)
+{
+  const size_t pageCount = bytes / PageSize;
+
+  this->m_atlas.assign(pageCount * PageSize, 0);
+  this->m_atlas.shrink_to_fit();
+  this->m_pageUsage.resize(pageCount);
+
+  this->clear();
+}
+
+void GlyphCache::setDistanceFields(SdfGlyphCache* fields)
+{
+  this->m_distanceFields = fields;
+  this->clear();
+}
+
+void GlyphCache::pin(const stbtt_fontinfo* font,
+                     u32 codepoint,
+                     float scale,
+                     const Glyph& glyph)
+{
+  this->m_pinned[{font, codepoint, scale}] = glyph;
+}
+
+const GlyphCache::Glyph& GlyphCache::get(const stbtt_fontinfo* font,
+                                         u32 codepoint,
+                                         float scale)
+{
+  const Key key = {font, codepoint, scale};
+
+  if (this->m_distanceFields == nullptr) {
+    if (auto it = this->m_pinned.find(key); it != this->m_pinned.end()) {
+      this->m_stats.hits++;
+      return it->second;
+    }
+  }
+
+  if (auto it = this->m_entries.find(key); it != this->m_entries.end()) {
+    this->m_stats.hits++;
+    this->m_lru.splice(this->m_lru.begin(), this->m_lru, it->second);
+
+    return it->second->glyph;
+  }
+
+  this->m_stats.misses++;
+
+  int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+  stbtt_GetCodepointBitmapBox(
+      font, codepoint, scale, scale, &x0, &y0, &x1, &y1);
+
+  Glyph glyph = {static_cast<s16>(x0),
+                 static_cast<s16>(y0),
+                 static_cast<u16>(x1 - x0),
+                 static_cast<u16>(y1 - y0),
+                 nullptr};
+
+  const u32 size = (glyph.width + 1) / 2 * glyph.height;
+
+  u32 slot = 0;
+  u8 sizeClass = NoSizeClass;
+
+  if (size > 0) {
+    this->m_bitmap.resize(glyph.width * glyph.height);
+    if (this->m_distanceFields != nullptr)
+      SdfGlyphCache::render(this->m_distanceFields->get(font, codepoint),
+                            scale,
+                            glyph,
+                            this->m_bitmap.data());
+    else
+      stbtt_MakeCodepointBitmap(font,
+                                this->m_bitmap.data(),
+                                glyph.width,
+                                glyph.height,
+                                glyph.width,
+                                scale,
+                                scale,
+                                codepoint);
+
+    if (size <= PageSize) {
+      sizeClass = getSizeClass(size);
+      slot = this->allocateSlot(sizeClass);
+    }
+
+    u8* coverage = nullptr;
+    if (sizeClass == NoSizeClass || slot == InvalidSlot) {
+      this->m_uncached.resize(size);
+      coverage = this->m_uncached.data();
+    } else
+      coverage = &this->m_atlas[slot];
+
+    pack(this->m_bitmap.data(), glyph.width, glyph.height, coverage);
+
+    glyph.coverage = coverage;
+
+    if (coverage == this->m_uncached.data()) {
+      this->m_uncachedGlyph = glyph;
+      return this->m_uncachedGlyph;
+    }
+  }
+
+  this->m_lru.push_front({key, glyph, slot, sizeClass});
+  this->m_entries.emplace(key, this->m_lru.begin());
+  this->m_modified = true;
+
+  return this->m_lru.front().glyph;
+}
+
+bool GlyphCache::contains(const stbtt_fontinfo* font,
+                          u32 codepoint,
+                          float scale) const
+{
+  const Key key = {font, codepoint, scale};
+
+  return this->m_entries.contains(key)
+      || (this->m_distanceFields == nullptr && this->m_pinned.contains(key));
+}
+
+void GlyphCache::insert(const stbtt_fontinfo* font,
+                        u32 codepoint,
+                        float scale,
+                        const Glyph& glyph)
+{
+  const u32 size = (glyph.width + 1) / 2 * glyph.height;
+
+  if (this->m_distanceFields != nullptr || size > PageSize
+      || this->contains(font, codepoint, scale))
+    return;
+
+  if (this->store({font, codepoint, scale}, glyph))
+    this->m_modified = true;
+}
+
+void GlyphCache::pack(const u8* bitmap, u16 width, u16 height, u8* coverage)
+{
+  // Two 4 bit coverage values per byte, left pixel in the low nibble
+  for (u32 row = 0; row < height; row++) {
+    for (u32 col = 0; col < width; col += 2, bitmap += 2)
+      *coverage++ = (bitmap[0] >> 4) | (col + 1 < width ? bitmap[1] & 0xF0 : 0);
+    bitmap -= width & 1;
+  }
+}
+
+void GlyphCache::clear()
+{
+  this->m_lru.clear();
+  this->m_entries.clear();
+
+  for (auto& freeSlots : this->m_freeSlots)
+    freeSlots.clear();
+
+  std::fill(this->m_pageUsage.begin(), this->m_pageUsage.end(), 0);
+
+  // Hand out the lowest pages first
+  this->m_freePages.resize(this->m_pageUsage.size());
+  for (u32 i = 0; i < this->m_freePages.size(); i++)
+    this->m_freePages[i] = this->m_freePages.size() - 1 - i;
+
+  this->m_modified = false;
+}
+
+bool GlyphCache::save(const std::string& path,
+                      std::span<const stbtt_fontinfo* const> fonts,
+                      u32 key)
+{
+  if (this->m_distanceFields != nullptr)
+    return false;
+
+  std::vector<FileGlyph> glyphs;
+  std::vector<u8> data;
+  glyphs.reserve(this->m_lru.size());
+
+  // Most recently used glyph first, like the cache
+  for (const Entry& entry : this->m_lru) {
+    const auto font = std::find(fonts.begin(), fonts.end(), entry.key.font);
+    if (font == fonts.end())
+      continue;
+
+    const Glyph& glyph = entry.glyph;
+    const u32 size = (glyph.width + 1) / 2 * glyph.height;
+
+    glyphs.push_back({entry.key.codepoint,
+                      entry.key.scale,
+                      static_cast<u8>(font - fonts.begin()),
+                      {},
+                      glyph.xOffset,
+                      glyph.yOffset,
+                      glyph.width,
+                      glyph.height,
+                      static_cast<u32>(data.size())});
+
+    if (size > 0)
+      data.insert(data.end(), glyph.coverage, glyph.coverage + size);
+  }
+
+  FileHeader header = {};
+  std::memcpy(header.magic, FileMagic, sizeof(FileMagic));
+  header.version = FileVersion;
+  header.key = key;
+  header.glyphCount = glyphs.size();
+  header.dataSize = data.size();
+
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == nullptr)
+    return false;
+
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+  written &= fwrite(glyphs.data(), sizeof(FileGlyph), glyphs.size(), file)
+      == glyphs.size();
+  written &= fwrite(data.data(), 1, data.size(), file) == data.size();
+  written &= fclose(file) == 0;
+
+  // A partially written file fails to validate on load, remove it anyway
+  if (!written) {
+    remove(path.c_str());
+    return false;
+  }
+
+  this->m_modified = false;
+  return true;
+}
+
+bool GlyphCache::load(const std::string& path,
+                      std::span<const stbtt_fontinfo* const> fonts,
+                      u32 key)
+{
+  FILE* file = fopen(path.c_str(), "rb");
+  if (file == nullptr)
+    return false;
+
+  fseek(file, 0, SEEK_END);
+  const long fileSize = ftell(file);
+  rewind(file);
+
+  std::vector<u8> contents(fileSize > 0 ? fileSize : 0);
+  const bool read = fileSize > 0
+      && fread(contents.data(), 1, contents.size(), file) == contents.size();
+  fclose(file);
+
+  FileHeader header;
+  if (!read || contents.size() < sizeof(header))
+    return false;
+
+  std::memcpy(&header, contents.data(), sizeof(header));
+
+  const size_t glyphsSize = size_t(header.glyphCount) * sizeof(FileGlyph);
+  if (std::memcmp(header.magic, FileMagic, sizeof(FileMagic)) != 0
+      || header.version != FileVersion || header.key != key
+      || contents.size() != sizeof(header) + glyphsSize + header.dataSize)
+    return false;
+
+  std::vector<FileGlyph> glyphs(header.glyphCount);
+  std::memcpy(glyphs.data(), contents.data() + sizeof(header), glyphsSize);
+  const u8* data = contents.data() + sizeof(header) + glyphsSize;
+
+  // Check everything first so a bad file adds nothing
+  for (const FileGlyph& glyph : glyphs) {
+    const u32 size = (glyph.width + 1) / 2 * glyph.height;
+
+    if (glyph.font >= fonts.size() || size > PageSize
+        || glyph.offset > header.dataSize
+        || size > header.dataSize - glyph.offset)
+      return false;
+  }
+
+  // Least recently used glyph first, so the most recent ones end up in front
+  // and are the last to get evicted if the atlas is smaller than before
+  for (auto it = glyphs.rbegin(); it != glyphs.rend(); it++) {
+    const Key glyphKey = {fonts[it->font], it->codepoint, it->scale};
+    const u32 size = (it->width + 1) / 2 * it->height;
+
+    if (this->m_entries.contains(glyphKey)
+        || this->m_pinned.contains(glyphKey))
+      continue;
+
+    const Glyph glyph = {it->xOffset,
+                         it->yOffset,
+                         it->width,
+                         it->height,
+                         size > 0 ? data + it->offset : nullptr};
+    if (!this->store(glyphKey, glyph))
+      break;
+  }
+
+  this->m_modified = false;
+  return true;
+}
+
+bool GlyphCache::store(const Key& key, const Glyph& glyph)
+{
+  const u32 size = (glyph.width + 1) / 2 * glyph.height;
+  Glyph stored = glyph;
+  u32 slot = 0;
+  u8 sizeClass = NoSizeClass;
+
+  if (size > 0) {
+    sizeClass = getSizeClass(size);
+    slot = this->allocateSlot(sizeClass);
+    if (slot == InvalidSlot)
+      return false;
+
+    std::memcpy(&this->m_atlas[slot], glyph.coverage, size);
+    stored.coverage = &this->m_atlas[slot];
+  }
+
+  this->m_lru.push_front({key, stored, slot, sizeClass});
+  this->m_entries.emplace(key, this->m_lru.begin());
+
+  return true;
+}
+
+u8 GlyphCache::getSizeClass(u32 size)
+{
+  u8 sizeClass = 0;
+  while ((MinSlotSize << sizeClass) < size)
+    sizeClass++;
+
+  return sizeClass;
+}
+
+u32 GlyphCache::allocateSlot(u8 sizeClass)
+{
+  auto& freeSlots = this->m_freeSlots[sizeClass];
+
+  if (this->m_pageUsage.empty())
+    return InvalidSlot;
+
+  while (freeSlots.empty()) {
+    if (!this->m_freePages.empty()) {
+      const u32 page = this->m_freePages.back();
+      const u32 slotSize = MinSlotSize << sizeClass;
+
+      this->m_freePages.pop_back();
+
+      for (u32 offset = PageSize; offset > 0; offset -= slotSize)
+        freeSlots.push_back(page * PageSize + offset - slotSize);
+    } else if (!this->m_lru.empty())
+      this->evict();
+    else
+      return InvalidSlot;
+  }
+
+  const u32 slot = freeSlots.back();
+  freeSlots.pop_back();
+  this->m_pageUsage[slot / PageSize]++;
+
+  return slot;
+}
+
+void GlyphCache::releaseSlot(u32 slot, u8 sizeClass)
+{
+  const u32 page = slot / PageSize;
+  auto& freeSlots = this->m_freeSlots[sizeClass];
+
+  if (--this->m_pageUsage[page] > 0) {
+    freeSlots.push_back(slot);
+    return;
+  }
+
+  // The page is empty, give it back so any size class can use it
+  std::erase_if(freeSlots,
+                [page](u32 freeSlot) { return freeSlot / PageSize == page; });
+  this->m_freePages.push_back(page);
+}
+
+void GlyphCache::evict()
+{
+  const Entry& entry = this->m_lru.back();
+
+  if (entry.sizeClass != NoSizeClass)
+    this->releaseSlot(entry.slot, entry.sizeClass);
+
+  this->m_entries.erase(entry.key);
+  this->m_lru.pop_back();
+  this->m_stats.evictions++;
+}
+
+}  // namespace tsl::gfx
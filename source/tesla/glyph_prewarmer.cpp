@@ -0,0 +1,183 @@
+//
+// Created by pugemon on 16.10.26.
+//
+#include <bit>
+#include <switch.h>
+
+#include "nikola/tesla/glyph_prewarmer.hpp"
+
+namespace tsl::gfx
+{
+
+bool GlyphPrewarmer::Request::operator==(const Request& other) const
+{
+  return this->font == other.font && this->codepoint == other.codepoint
+      && std::bit_cast<u32>(this->scale) == std::bit_cast<u32>(other.scale);
+}
+
+size_t GlyphPrewarmer::RequestHash::operator()(const Request& request) const
+{
+  const u64 hash =
+      reinterpret_cast<uintptr_t>(request.font) * 0x9E3779B97F4A7C15
+      ^ (u64(std::bit_cast<u32>(request.scale)) << 21) ^ request.codepoint;
+
+  return std::hash<u64> {}(hash);
+}
+
+bool GlyphPrewarmer::start()
+{
+  if (this->m_running)
+    return true;
+
+  this->m_stopping = false;
+
+#if defined(__SWITCH__)
+  // Lowest priority, it only runs while rendering leaves the core idle
+  if (R_FAILED(threadCreate(
+          &this->m_thread,
+          [](void* prewarmer)
+          { static_cast<GlyphPrewarmer*>(prewarmer)->workerMain(); },
+          this,
+          nullptr,
+          0x4000,
+          0x3F,
+          -2)))
+    return false;
+
+  if (R_FAILED(threadStart(&this->m_thread))) {
+    threadClose(&this->m_thread);
+    return false;
+  }
+#else
+  this->m_thread = std::thread(&GlyphPrewarmer::workerMain, this);
+#endif
+
+  this->m_running = true;
+  return true;
+}
+
+void GlyphPrewarmer::stop()
+{
+  if (!this->m_running)
+    return;
+
+  {
+    std::scoped_lock lock(this->m_mutex);
+    this->m_stopping = true;
+    this->m_queue.clear();
+  }
+  this->m_wake.notify_all();
+
+#if defined(__SWITCH__)
+  threadWaitForExit(&this->m_thread);
+  threadClose(&this->m_thread);
+#else
+  this->m_thread.join();
+#endif
+
+  this->m_running = false;
+  this->m_scheduled.clear();
+  this->m_results.clear();
+}
+
+void GlyphPrewarmer::schedule(const Request& request)
+{
+  // Nothing would ever pick it up, the glyph gets rasterized when drawn
+  if (!this->m_running)
+    return;
+
+  {
+    std::scoped_lock lock(this->m_mutex);
+    if (!this->m_scheduled.insert(request).second)
+      return;
+
+    this->m_queue.push_back(request);
+  }
+  this->m_wake.notify_one();
+}
+
+void GlyphPrewarmer::collect(GlyphCache& cache)
+{
+  std::vector<Result> results;
+
+  {
+    std::scoped_lock lock(this->m_mutex);
+    if (this->m_results.empty())
+      return;
+
+    results.swap(this->m_results);
+    for (const Result& result : results)
+      this->m_scheduled.erase(result.request);
+  }
+
+  for (const Result& result : results)
+    cache.insert(result.request.font,
+                 result.request.codepoint,
+                 result.request.scale,
+                 result.glyph);
+}
+
+void GlyphPrewarmer::workerMain()
+{
+  std::vector<u8> bitmap;
+
+  while (true) {
+    Request request;
+
+    {
+      std::unique_lock lock(this->m_mutex);
+      this->m_wake.wait(
+          lock, [this] { return this->m_stopping || !this->m_queue.empty(); });
+
+      if (this->m_stopping)
+        return;
+
+      request = this->m_queue.front();
+      this->m_queue.pop_front();
+    }
+
+    // stb_truetype only reads the font, so it can run next to the renderer
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    stbtt_GetCodepointBitmapBox(request.font,
+                                request.codepoint,
+                                request.scale,
+                                request.scale,
+                                &x0,
+                                &y0,
+                                &x1,
+                                &y1);
+
+    Result result = {request,
+                     {static_cast<s16>(x0),
+                      static_cast<s16>(y0),
+                      static_cast<u16>(x1 - x0),
+                      static_cast<u16>(y1 - y0),
+                      nullptr},
+                     {}};
+    GlyphCache::Glyph& glyph = result.glyph;
+
+    if (glyph.width > 0 && glyph.height > 0) {
+      bitmap.resize(glyph.width * glyph.height);
+      stbtt_MakeCodepointBitmap(request.font,
+                                bitmap.data(),
+                                glyph.width,
+                                glyph.height,
+                                glyph.width,
+                                request.scale,
+                                request.scale,
+                                request.codepoint);
+
+      result.coverage.resize((glyph.width + 1) / 2 * glyph.height);
+      GlyphCache::pack(
+          bitmap.data(), glyph.width, glyph.height, result.coverage.data());
+
+      // Stays valid when the result gets moved, the vector keeps its buffer
+      glyph.coverage = result.coverage.data();
+    }
+
+    std::scoped_lock lock(this->m_mutex);
+    this->m_results.push_back(std::move(result));
+  }
+}
+
+}  // namespace tsl::gfx
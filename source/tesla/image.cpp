@@ -0,0 +1,257 @@
+//
+// Created by pugemon on 16.10.26.
+//
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <switch.h>
+
+#include "nikola/tesla/image.hpp"
+
+namespace tsl::gfx
+{
+
+namespace
+{
+
+/**
+ * @brief Header of the libnikola image format, see \ref Image
+ */
+struct FileHeader
+{
+  char magic[4];
+  u8 version;
+  u8 flags;
+  u16 width, height;
+  u16 reserved;
+  u32 dataSize;  ///< Bytes of pixel data following the header
+};
+
+static_assert(sizeof(FileHeader) == 16);
+
+constexpr char FileMagic[4] = {'N', 'K', 'I', 'M'};
+constexpr u8 FileVersion = 1;
+constexpr u8 FlagRunLength = 1 << 0;
+
+/**
+ * @brief Checks that no color channel of a RGBA4444 pixel exceeds its alpha
+ *
+ * @param pixel Pixel
+ * @return Pixel is premultiplied
+ */
+bool isPremultiplied(u16 pixel)
+{
+  const u16 alpha = pixel >> 12;
+
+  return (pixel & 0xF) <= alpha && ((pixel >> 4) & 0xF) <= alpha
+      && ((pixel >> 8) & 0xF) <= alpha;
+}
+
+/**
+ * @brief Decodes run length encoded pixels
+ *
+ * @param data Encoded pixels
+ * @param size Size of the encoded pixels in bytes
+ * @param pixels Decoded pixels
+ * @param count Number of pixels to decode
+ * @return false if the data doesn't decode to exactly count pixels
+ */
+bool decodeRunLength(const u8* data, size_t size, u16* pixels, size_t count)
+{
+  const auto read = [&](u16& value)
+  {
+    if (size < sizeof(u16))
+      return false;
+
+    std::memcpy(&value, data, sizeof(u16));
+    data += sizeof(u16);
+    size -= sizeof(u16);
+
+    return true;
+  };
+
+  while (count > 0) {
+    u16 header;
+    if (!read(header))
+      return false;
+
+    const size_t length = (header & 0x7FFF) + 1;
+    if (length > count)
+      return false;
+
+    if (header & 0x8000) {
+      u16 pixel;
+      if (!read(pixel))
+        return false;
+
+      std::fill_n(pixels, length, pixel);
+    } else {
+      if (size < length * sizeof(u16))
+        return false;
+
+      std::memcpy(pixels, data, length * sizeof(u16));
+      data += length * sizeof(u16);
+      size -= length * sizeof(u16);
+    }
+
+    pixels += length;
+    count -= length;
+  }
+
+  return size == 0;
+}
+
+}  // namespace
+
+void Image::load(const u8* bmp, u16 width, u16 height)
+{
+  this->m_width = width;
+  this->m_height = height;
+  this->m_pixels.resize(width * height);
+
+  for (u16& pixel : this->m_pixels) {
+    const u16 alpha = bmp[0] >> 4;
+
+    // Exact division by 15, see blend.cpp
+    const auto premultiply = [alpha](u8 channel) -> u16
+    { return ((channel >> 4) * alpha * 137) >> 11; };
+
+    pixel = premultiply(bmp[1]) | premultiply(bmp[2]) << 4
+        | premultiply(bmp[3]) << 8 | alpha << 12;
+
+    bmp += 4;
+  }
+
+  this->classifyRows();
+}
+
+void Image::loadPixels(const u16* pixels, u16 width, u16 height)
+{
+  this->m_width = width;
+  this->m_height = height;
+  this->m_pixels.resize(width * height);
+
+  for (u16& pixel : this->m_pixels) {
+    const u16 source = *pixels++;
+    const u16 alpha = source >> 12;
+
+    const auto premultiply = [alpha](u16 channel) -> u16
+    { return ((channel & 0xF) * alpha * 137) >> 11; };
+
+    pixel = premultiply(source) | premultiply(source >> 4) << 4
+        | premultiply(source >> 8) << 8 | alpha << 12;
+  }
+
+  this->classifyRows();
+}
+
+bool Image::loadMemory(const u8* data, size_t size)
+{
+  this->clear();
+
+  FileHeader header;
+  if (size < sizeof(header))
+    return false;
+
+  std::memcpy(&header, data, sizeof(header));
+  data += sizeof(header);
+  size -= sizeof(header);
+
+  if (std::memcmp(header.magic, FileMagic, sizeof(FileMagic)) != 0
+      || header.version != FileVersion || header.dataSize != size)
+    return false;
+
+  const size_t count = header.width * header.height;
+  this->m_pixels.resize(count);
+
+  if (header.flags & FlagRunLength) {
+    if (!decodeRunLength(data, size, this->m_pixels.data(), count)) {
+      this->clear();
+      return false;
+    }
+  } else {
+    if (size != count * sizeof(u16)) {
+      this->clear();
+      return false;
+    }
+
+    std::memcpy(this->m_pixels.data(), data, size);
+  }
+
+  // Blending relies on no channel exceeding the alpha, the sums would carry
+  // into the next channel otherwise
+  if (!std::all_of(
+          this->m_pixels.begin(), this->m_pixels.end(), isPremultiplied))
+  {
+    this->clear();
+    return false;
+  }
+
+  this->m_width = header.width;
+  this->m_height = header.height;
+  this->classifyRows();
+
+  return true;
+}
+
+bool Image::loadFile(const std::string& path)
+{
+  FILE* file = fopen(path.c_str(), "rb");
+
+  if (file == nullptr) {
+    this->clear();
+    return false;
+  }
+
+  fseek(file, 0, SEEK_END);
+  const long fileSize = ftell(file);
+  rewind(file);
+
+  std::vector<u8> data(fileSize > 0 ? fileSize : 0);
+  const bool read =
+      fileSize > 0 && fread(data.data(), 1, data.size(), file) == data.size();
+  fclose(file);
+
+  if (!read) {
+    this->clear();
+    return false;
+  }
+
+  return this->loadMemory(data.data(), data.size());
+}
+
+void Image::classifyRows()
+{
+  this->m_rowTypes.resize(this->m_height);
+  this->m_opaque = true;
+
+  for (u16 y = 0; y < this->m_height; y++) {
+    const u16* row = this->getRow(y);
+    bool opaque = true, transparent = true;
+
+    for (u16 x = 0; x < this->m_width; x++) {
+      opaque &= (row[x] >> 12) == 0xF;
+      transparent &= (row[x] >> 12) == 0x0;
+    }
+
+    if (opaque)
+      this->m_rowTypes[y] = RowType::Opaque;
+    else if (transparent)
+      this->m_rowTypes[y] = RowType::Transparent;
+    else
+      this->m_rowTypes[y] = RowType::Translucent;
+
+    this->m_opaque &= opaque;
+  }
+}
+
+void Image::clear()
+{
+  this->m_width = 0;
+  this->m_height = 0;
+  this->m_opaque = false;
+  this->m_pixels.clear();
+  this->m_rowTypes.clear();
+}
+
+}  // namespace tsl::gfx
@@ -0,0 +1,34 @@
+//
+// Created by pugemon on 16.10.26.
+//
+#include <algorithm>
+#include <switch.h>
+
+#include "nikola/tesla/scrolling_text.hpp"
+
+namespace tsl::gfx
+{
+
+void ScrollingText::restart()
+{
+  this->m_start = std::chrono::steady_clock::now();
+}
+
+u32 ScrollingText::getOffset() const
+{
+  using namespace std::chrono;
+
+  const u64 pause = duration_cast<milliseconds>(Pause).count();
+  const u64 cycle = pause + u64(this->m_width + Gap) * 1000 / Speed;
+  const u64 elapsed =
+      duration_cast<milliseconds>(steady_clock::now() - this->m_start).count();
+
+  // Rest at the start of every pass, then move a full text width plus the gap
+  const u64 t = elapsed % cycle;
+  if (t < pause)
+    return 0;
+
+  return std::min<u64>((t - pause) * Speed / 1000, this->m_width + Gap - 1);
+}
+
+}  // namespace tsl::gfx
@@ -0,0 +1,137 @@
+//
+// Created by pugemon on 16.10.26.
+//
+#include <algorithm>
+#include <cmath>
+#include <switch.h>
+
+#include "nikola/tesla/sdf_glyph_cache.hpp"
+
+namespace tsl::gfx
+{
+
+size_t SdfGlyphCache::KeyHash::operator()(const Key& key) const
+{
+  const u64 hash = reinterpret_cast<uintptr_t>(key.font) * 0x9E3779B97F4A7C15
+      ^ key.codepoint;
+
+  return std::hash<u64> {}(hash);
+}
+
+void SdfGlyphCache::setCapacity(size_t bytes)
+{
+  this->m_capacity = bytes;
+  this->clear();
+}
+
+const SdfGlyphCache::Glyph& SdfGlyphCache::get(const stbtt_fontinfo* font,
+                                               u32 codepoint)
+{
+  const Key key = {font, codepoint};
+
+  if (auto it = this->m_entries.find(key); it != this->m_entries.end())
+    return it->second.glyph;
+
+  const float scale = stbtt_ScaleForPixelHeight(font, BaseHeight);
+
+  Entry entry = {};
+  entry.glyph.scale = scale;
+  stbtt_GetCodepointBox(font,
+                        codepoint,
+                        &entry.glyph.box[0],
+                        &entry.glyph.box[1],
+                        &entry.glyph.box[2],
+                        &entry.glyph.box[3]);
+
+  int width = 0, height = 0, xOffset = 0, yOffset = 0;
+  u8* field = stbtt_GetCodepointSDF(font,
+                                    scale,
+                                    codepoint,
+                                    Padding,
+                                    EdgeValue,
+                                    DistanceScale,
+                                    &width,
+                                    &height,
+                                    &xOffset,
+                                    &yOffset);
+
+  if (field != nullptr) {
+    entry.distance.assign(field, field + width * height);
+    stbtt_FreeSDF(field, nullptr);
+
+    entry.glyph.xOffset = xOffset;
+    entry.glyph.yOffset = yOffset;
+    entry.glyph.width = width;
+    entry.glyph.height = height;
+  }
+
+  // Fields are small and cheap to recreate compared to tracking their use
+  if (this->m_size + entry.distance.size() > this->m_capacity)
+    this->clear();
+  this->m_size += entry.distance.size();
+
+  Entry& inserted =
+      this->m_entries.emplace(key, std::move(entry)).first->second;
+  inserted.glyph.distance =
+      inserted.distance.empty() ? nullptr : inserted.distance.data();
+
+  return inserted.glyph;
+}
+
+void SdfGlyphCache::render(const Glyph& glyph,
+                           float scale,
+                           const GlyphCache::Glyph& box,
+                           u8* bitmap)
+{
+  // Field pixels per output pixel, and output pixels per field value
+  const float step = glyph.scale / scale;
+  const float pixels = scale / glyph.scale / DistanceScale;
+
+  const auto sample = [&glyph](s32 x, s32 y) -> s32
+  {
+    if (x < 0 || y < 0 || x >= glyph.width || y >= glyph.height)
+      return 0;
+    return glyph.distance[y * glyph.width + x];
+  };
+
+  if (glyph.distance == nullptr) {
+    std::fill_n(bitmap, box.width * box.height, 0);
+    return;
+  }
+
+  for (s32 row = 0; row < box.height; row++) {
+    // Pixel centers mapped into the field, whose pixel centers sit at +0.5
+    const float fieldY =
+        (box.yOffset + row + 0.5F) * step - glyph.yOffset - 0.5F;
+    const s32 sampleY = std::floor(fieldY);
+    const float fractionY = fieldY - sampleY;
+
+    float fieldX = (box.xOffset + 0.5F) * step - glyph.xOffset - 0.5F;
+
+    for (s32 col = 0; col < box.width; col++, fieldX += step) {
+      const s32 sampleX = std::floor(fieldX);
+      const float fractionX = fieldX - sampleX;
+
+      const float top = sample(sampleX, sampleY)
+          + (sample(sampleX + 1, sampleY) - sample(sampleX, sampleY))
+              * fractionX;
+      const float bottom = sample(sampleX, sampleY + 1)
+          + (sample(sampleX + 1, sampleY + 1) - sample(sampleX, sampleY + 1))
+              * fractionX;
+      const float distance =
+          (top + (bottom - top) * fractionY - EdgeValue) * pixels;
+
+      // Smoothstep over one output pixel across the outline
+      const float t = std::clamp(distance + 0.5F, 0.0F, 1.0F);
+      *bitmap++ = t * t * (3.0F - 2.0F * t) * 255.0F + 0.5F;
+    }
+  }
+}
+
+void SdfGlyphCache::clear()
+{
+  this->m_entries.clear();
+  this->m_size = 0;
+}
+
+}  // namespace tsl::gfx
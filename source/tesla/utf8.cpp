@@ -0,0 +1,170 @@
+//
+// Created by pugemon on 16.10.26.
+//
+#include <cstring>
+#include <switch.h>
+
+#include "nikola/tesla/utf8.hpp"
+
+#if defined(__ARM_NEON)
+#  include <arm_neon.h>
+#elif defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+namespace tsl::gfx
+{
+
+namespace
+{
+
+/// Bytes checked and widened at once by \ref widenAscii
+constexpr u32 AsciiBlock = 16;
+
+#if defined(__ARM_NEON)
+
+/**
+ * @brief Widens a block of bytes to codepoints if all of them are ASCII
+ *
+ * @param bytes AsciiBlock bytes
+ * @param out Receives AsciiBlock codepoints, untouched if any byte isn't ASCII
+ * @return Whether the block was ASCII
+ */
+inline bool widenAscii(const u8* bytes, u32* out)
+{
+  const uint8x16_t block = vld1q_u8(bytes);
+  const uint64x2_t words = vreinterpretq_u64_u8(block);
+  if (((vgetq_lane_u64(words, 0) | vgetq_lane_u64(words, 1))
+       & 0x8080808080808080)
+      != 0)
+    return false;
+
+  const uint16x8_t low = vmovl_u8(vget_low_u8(block));
+  const uint16x8_t high = vmovl_u8(vget_high_u8(block));
+  vst1q_u32(out, vmovl_u16(vget_low_u16(low)));
+  vst1q_u32(out + 4, vmovl_u16(vget_high_u16(low)));
+  vst1q_u32(out + 8, vmovl_u16(vget_low_u16(high)));
+  vst1q_u32(out + 12, vmovl_u16(vget_high_u16(high)));
+
+  return true;
+}
+
+#elif defined(__SSE2__)
+
+inline bool widenAscii(const u8* bytes, u32* out)
+{
+  const __m128i block =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+  if (_mm_movemask_epi8(block) != 0)
+    return false;
+
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i low = _mm_unpacklo_epi8(block, zero);
+  const __m128i high = _mm_unpackhi_epi8(block, zero);
+  __m128i* const dst = reinterpret_cast<__m128i*>(out);
+  _mm_storeu_si128(dst, _mm_unpacklo_epi16(low, zero));
+  _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(low, zero));
+  _mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(high, zero));
+  _mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(high, zero));
+
+  return true;
+}
+
+#else
+
+inline bool widenAscii(const u8* bytes, u32* out)
+{
+  u64 words[2];
+  std::memcpy(words, bytes, sizeof(words));
+  if (((words[0] | words[1]) & 0x8080808080808080) != 0)
+    return false;
+
+  for (u32 i = 0; i < AsciiBlock; i++)
+    out[i] = bytes[i];
+
+  return true;
+}
+
+#endif
+
+/**
+ * @brief Decodes a multi byte sequence the same way decode_utf8 does
+ *
+ * @param bytes First byte of the sequence
+ * @param available Number of bytes left in the string
+ * @param codepoint Receives the codepoint
+ * @return Length of the sequence, 0 if it's malformed or truncated
+ */
+u32 decodeSequence(const u8* bytes, size_t available, u32& codepoint)
+{
+  const u8 lead = bytes[0];
+  u32 length = 0;
+
+  if (lead >= 0xC2 && lead < 0xE0)
+    length = 2;
+  else if (lead >= 0xE0 && lead < 0xF0)
+    length = 3;
+  else if (lead >= 0xF0 && lead < 0xF5)
+    length = 4;
+
+  if (length == 0 || available < length)
+    return 0;
+
+  for (u32 i = 1; i < length; i++)
+    if ((bytes[i] & 0xC0) != 0x80)
+      return 0;
+
+  // Overlong encodings, UTF-16 surrogates and codepoints past U+10FFFF
+  if ((lead == 0xE0 && bytes[1] < 0xA0) || (lead == 0xED && bytes[1] >= 0xA0)
+      || (lead == 0xF0 && bytes[1] < 0x90)
+      || (lead == 0xF4 && bytes[1] >= 0x90))
+    return 0;
+
+  codepoint = lead & (0x7F >> length);
+  for (u32 i = 1; i < length; i++)
+    codepoint = codepoint << 6 | (bytes[i] & 0x3F);
+
+  return length;
+}
+
+}  // namespace
+
+void decodeUtf8(std::string_view string, std::vector<u32>& codepoints)
+{
+  const u8* bytes = reinterpret_cast<const u8*>(string.data());
+  const size_t size = string.size();
+
+  // Never more codepoints than bytes
+  codepoints.resize(size);
+  u32* out = codepoints.data();
+
+  size_t i = 0;
+  while (i < size) {
+    // ASCII, which is nearly all menu text, gets widened a block at a time.
+    // There are never fewer codepoints left to write than bytes left to read
+    while (i + AsciiBlock <= size && widenAscii(bytes + i, out)) {
+      i += AsciiBlock;
+      out += AsciiBlock;
+    }
+
+    if (i == size)
+      break;
+
+    if (bytes[i] < 0x80) {
+      *out++ = bytes[i++];
+      continue;
+    }
+
+    u32 codepoint = 0;
+    const u32 length = decodeSequence(bytes + i, size - i, codepoint);
+    if (length == 0)
+      break;
+
+    *out++ = codepoint;
+    i += length;
+  }
+
+  codepoints.resize(out - codepoints.data());
+}
+
+}  // namespace tsl::gfx
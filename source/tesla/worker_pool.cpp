@@ -0,0 +1,148 @@
+//
+// Created by pugemon on 16.10.26.
+//
+#include <switch.h>
+
+#include "nikola/tesla/worker_pool.hpp"
+
+namespace tsl::gfx
+{
+
+void WorkerPool::start(u32 threadCount)
+{
+  this->stop();
+
+  // No worker is left that could have seen an earlier job
+  this->m_stopping = false;
+  this->m_generation = 0;
+  this->m_threads.resize(threadCount);
+
+#if defined(__SWITCH__)
+  // Workers only help if they run next to the calling thread, so they go to
+  // the other cores the process may use first and share one only after that
+  std::vector<int> cores;
+  const int ownCore = svcGetCurrentProcessorNumber();
+  if (u64 coreMask = 0; R_SUCCEEDED(
+          svcGetInfo(&coreMask, InfoType_CoreMask, CUR_PROCESS_HANDLE, 0)))
+  {
+    for (int core = 0; core < 64; core++)
+      if ((coreMask >> core & 1) != 0 && core != ownCore)
+        cores.push_back(core);
+    if ((coreMask >> ownCore & 1) != 0)
+      cores.push_back(ownCore);
+  }
+  if (cores.empty())
+    cores.push_back(-2);
+
+  // libnx keeps pointers to running threads, so they're created in place and
+  // the ones that failed are only dropped from the end
+  u32 started = 0;
+  for (u32 i = 0; i < threadCount; i++) {
+    Thread& thread = this->m_threads[started];
+
+    if (R_FAILED(threadCreate(
+            &thread,
+            [](void* pool) { static_cast<WorkerPool*>(pool)->workerMain(); },
+            this,
+            nullptr,
+            0x4000,
+            0x2C,
+            cores[i % cores.size()])))
+      continue;
+
+    if (R_FAILED(threadStart(&thread))) {
+      threadClose(&thread);
+      continue;
+    }
+
+    started++;
+  }
+
+  // run() waits for every thread in the list, it may only hold running ones
+  this->m_threads.resize(started);
+#else
+  for (auto& thread : this->m_threads)
+    thread = std::thread(&WorkerPool::workerMain, this);
+#endif
+}
+
+void WorkerPool::stop()
+{
+  {
+    std::scoped_lock lock(this->m_mutex);
+    this->m_stopping = true;
+  }
+  this->m_wake.notify_all();
+
+  for (auto& thread : this->m_threads) {
+#if defined(__SWITCH__)
+    threadWaitForExit(&thread);
+    threadClose(&thread);
+#else
+    thread.join();
+#endif
+  }
+
+  this->m_threads.clear();
+}
+
+void WorkerPool::run(u32 count, const std::function<void(u32)>& job)
+{
+  if (this->m_threads.empty()) {
+    for (u32 i = 0; i < count; i++)
+      job(i);
+    return;
+  }
+
+  {
+    std::scoped_lock lock(this->m_mutex);
+    this->m_job = &job;
+    this->m_count = count;
+    this->m_next = 0;
+    this->m_busy = this->m_threads.size();
+    this->m_generation++;
+  }
+  this->m_wake.notify_all();
+
+  this->work();
+
+  std::unique_lock lock(this->m_mutex);
+  this->m_done.wait(lock, [this] { return this->m_busy == 0; });
+  this->m_job = nullptr;
+}
+
+void WorkerPool::workerMain()
+{
+  u64 generation = 0;
+
+  while (true) {
+    {
+      std::unique_lock lock(this->m_mutex);
+      this->m_wake.wait(lock,
+                        [&]
+                        {
+                          return this->m_stopping
+                              || this->m_generation != generation;
+                        });
+
+      if (this->m_stopping)
+        return;
+
+      generation = this->m_generation;
+    }
+
+    this->work();
+
+    std::scoped_lock lock(this->m_mutex);
+    if (--this->m_busy == 0)
+      this->m_done.notify_one();
+  }
+}
+
+void WorkerPool::work()
+{
+  for (u32 i = this->m_next++; i < this->m_count; i = this->m_next++)
+    (*this->m_job)(i);
+}
+
+}  // namespace tsl::gfx
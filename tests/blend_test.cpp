@@ -0,0 +1,255 @@
+//
+// Created by pugemon on 16.10.26.
+//
+// Checks the row blend kernels against per pixel versions of what the
+// renderer does, with a plain division by 15 instead of the multiply and
+// shift the kernels use. Every channel, destination and alpha combination
+// gets blended, in runs of varying length so both the vector loop and the
+// scalar tail run. Built with SSE2 or NEON, whatever the host has, and once
+// without either for the scalar kernels.
+//
+#include <cstdio>
+#include <vector>
+
+#include <switch.h>
+
+#include "nikola/tesla/blend.hpp"
+
+using namespace tsl::gfx;
+
+namespace
+{
+
+u32 g_failures = 0;
+
+// Same as Renderer::blendColor, src is the pixel drawn over
+u16 blendColor(u16 src, u16 dst, u16 alpha)
+{
+  return (dst * alpha + src * (0xF - alpha)) / 0xF;
+}
+
+u16 channel(u16 pixel, u32 shift)
+{
+  return (pixel >> shift) & 0xF;
+}
+
+// Pixel with the same value in every color channel
+u16 grey(u16 value, u16 alpha)
+{
+  return value | value << 4 | value << 8 | alpha << 12;
+}
+
+/**
+ * @brief Blends a source color over a pixel, every channel like
+ * Renderer::setPixelBlendSrc
+ */
+u16 blendPixel(u16 pixel, u16 source, u16 alpha)
+{
+  u16 result = 0;
+  for (u32 shift = 0; shift < 12; shift += 4)
+    result |= blendColor(channel(pixel, shift), channel(source, shift), alpha)
+        << shift;
+
+  return result;
+}
+
+/**
+ * @brief Runs a kernel over the destination in runs of 0 - 19 pixels, then
+ * compares every pixel with the expected one
+ */
+template<typename Kernel>
+void check(const char* name,
+           std::vector<u16> dst,
+           const std::vector<u16>& expected,
+           Kernel kernel)
+{
+  for (u32 start = 0, length = 0; start < dst.size();
+       start += length, length = (length + 1) % 20)
+  {
+    if (start + length > dst.size())
+      length = dst.size() - start;
+    kernel(dst.data() + start, start, length);
+  }
+
+  for (u32 i = 0; i < dst.size(); i++)
+    if (dst[i] != expected[i]) {
+      if (g_failures++ < 20)
+        std::printf("%s: pixel %u is 0x%04X, expected 0x%04X\n",
+                    name,
+                    i,
+                    dst[i],
+                    expected[i]);
+    }
+}
+
+void checkFill()
+{
+  // Every color channel value and alpha over every pixel
+  std::vector<u16> dst(0x10000), expected(0x10000);
+  for (u32 i = 0; i < dst.size(); i++)
+    dst[i] = i;
+
+  for (u16 alpha = 0; alpha < 16; alpha++)
+    for (u16 value = 0; value < 16; value++) {
+      const Color color = grey(value, alpha);
+
+      for (u32 i = 0; i < dst.size(); i++)
+        expected[i] = blendPixel(dst[i], color.rgba, alpha) | alpha << 12;
+
+      check("fill",
+            dst,
+            expected,
+            [&](u16* run, u32, u32 length)
+            { blend::fill(run, length, color); });
+    }
+}
+
+void checkSpan()
+{
+  std::vector<u16> dst(0x10000), src(0x10000), expected(0x10000);
+  for (u32 i = 0; i < dst.size(); i++)
+    dst[i] = i;
+
+  for (u16 alpha = 0; alpha < 16; alpha++)
+    for (u16 value = 0; value < 16; value++) {
+      // Neighbouring lanes get different sources, the kernel blends each
+      // pixel with its own alpha
+      for (u32 i = 0; i < dst.size(); i++) {
+        src[i] = grey((value + i) & 0xF, (alpha + i / 16) & 0xF);
+        expected[i] = blendPixel(dst[i], src[i], src[i] >> 12)
+            | (dst[i] & 0xF000);
+      }
+
+      check("span",
+            dst,
+            expected,
+            [&](u16* run, u32 start, u32 length)
+            { blend::span(run, src.data() + start, length); });
+    }
+}
+
+void checkMask()
+{
+  // Every channel value of the destination at every coverage value
+  std::vector<u16> dst(16 * 256), expected(16 * 256);
+  std::vector<u8> coverage(16 * 256), nibbles(16 * 256);
+  for (u32 i = 0; i < dst.size(); i++) {
+    dst[i] = grey(i & 0xF, (i * 7) & 0xF);
+    coverage[i] = i >> 4;
+    nibbles[i] = coverage[i] >> 4;
+  }
+
+  blend::CoverageTable table;
+
+  for (u16 alpha = 0; alpha < 16; alpha++)
+    for (u16 value = 0; value < 16; value++) {
+      const Color color = grey(value, alpha);
+
+      for (u32 i = 0; i < dst.size(); i++)
+        expected[i] =
+            blendPixel(dst[i], color.rgba, (coverage[i] >> 4) * alpha / 0xF)
+            | (dst[i] & 0xF000);
+
+      check("mask",
+            dst,
+            expected,
+            [&](u16* run, u32 start, u32 length)
+            { blend::mask(run, coverage.data() + start, length, color); });
+
+      table.build(color);
+      check("coverage",
+            dst,
+            expected,
+            [&](u16* run, u32 start, u32 length)
+            { blend::coverage(run, nibbles.data() + start, length, table); });
+    }
+}
+
+void checkCopy()
+{
+  std::vector<u16> dst(0x10000), src(0x10000), expected(0x10000);
+  for (u32 i = 0; i < dst.size(); i++) {
+    dst[i] = i;
+    src[i] = (i * 0x9E37) | 0xF000;
+    expected[i] = (src[i] & 0x0FFF) | (dst[i] & 0xF000);
+  }
+
+  check("copy",
+        dst,
+        expected,
+        [&](u16* run, u32 start, u32 length)
+        { blend::copy(run, src.data() + start, length); });
+
+  // Opaque sources give the same result as source blending them
+  for (u32 i = 0; i < dst.size(); i++)
+    expected[i] = blendPixel(dst[i], src[i], 0xF) | (dst[i] & 0xF000);
+
+  check("copy as span",
+        dst,
+        expected,
+        [&](u16* run, u32 start, u32 length)
+        { blend::copy(run, src.data() + start, length); });
+}
+
+void checkPremultiplied()
+{
+  // Every premultiplied source, where no channel exceeds the alpha
+  std::vector<u16> src;
+  for (u16 alpha = 0; alpha < 16; alpha++)
+    for (u16 value = 0; value <= alpha; value++)
+      src.push_back(grey(value, alpha));
+
+  std::vector<u16> dst, sources, expected;
+  for (u16 source : src)
+    for (u16 value = 0; value < 16; value++) {
+      dst.push_back(grey(value, value ^ 0x5));
+      sources.push_back(source);
+    }
+  expected.resize(dst.size());
+
+  for (u16 opacity = 0; opacity < 16; opacity++) {
+    for (u32 i = 0; i < dst.size(); i++) {
+      const u16 alpha = (sources[i] >> 12) * opacity / 0xF;
+
+      expected[i] = dst[i] & 0xF000;
+      for (u32 shift = 0; shift < 12; shift += 4) {
+        const u16 value = channel(sources[i], shift) * opacity / 0xF
+            + channel(dst[i], shift) * (0xF - alpha) / 0xF;
+
+        if (value > 0xF) {
+          std::printf("premultiplied: channel overflows for 0x%04X\n",
+                      sources[i]);
+          g_failures++;
+        }
+        expected[i] |= value << shift;
+      }
+    }
+
+    check("premultiplied",
+          dst,
+          expected,
+          [&](u16* run, u32 start, u32 length)
+          {
+            blend::premultiplied(
+                run, sources.data() + start, length, opacity);
+          });
+  }
+}
+
+}  // namespace
+
+int main()
+{
+  checkFill();
+  checkSpan();
+  checkMask();
+  checkCopy();
+  checkPremultiplied();
+
+  if (g_failures != 0) {
+    std::printf("%u pixels differ\n", g_failures);
+    return 1;
+  }
+
+  return 0;
+}
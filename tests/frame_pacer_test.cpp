@@ -0,0 +1,171 @@
+//
+// Created by pugemon on 16.10.26.
+//
+// Drives the frame pacer with a fake clock through each pacing mode: deadline
+// recovery after an overrun in fixed interval mode, where rendering starts in
+// low latency mode and the interval and counters in vsync mode.
+//
+#include <cstdio>
+
+#include <switch.h>
+
+#include "nikola/tesla/frame_pacer.hpp"
+
+using namespace tsl::gfx;
+
+namespace
+{
+
+constexpr u64 Millisecond = 1'000'000;
+
+u32 g_failures = 0;
+
+// Starts late, the pacer treats a present at time 0 as no present yet
+u64 g_now = 1000 * Millisecond;
+
+void expect(const char* what, u64 value, u64 expected)
+{
+  if (value == expected)
+    return;
+
+  g_failures++;
+  std::printf("%s is %llu, expected %llu\n",
+              what,
+              static_cast<unsigned long long>(value),
+              static_cast<unsigned long long>(expected));
+}
+
+/**
+ * @brief Renders one frame taking renderTime, then sleeps and waits for
+ * vsyncs as told and presents. Vsyncs happen on multiples of the refresh
+ * period
+ *
+ * @return What the pacer asked for before presenting
+ */
+FramePacer::Present frame(FramePacer& pacer, u64 renderTime)
+{
+  g_now += pacer.getStartDelay();
+
+  pacer.onFrameStart();
+  g_now += renderTime;
+  const FramePacer::Present present = pacer.onFrameEnd();
+
+  g_now += present.sleep;
+  if (present.vsyncs != 0)
+    g_now = (g_now / FramePacer::VSyncPeriod + present.vsyncs)
+        * FramePacer::VSyncPeriod;
+  pacer.onPresented();
+
+  return present;
+}
+
+void checkFixedInterval()
+{
+  FramePacer pacer([] { return g_now; });
+  pacer.configure(PacingMode::FixedInterval, 50);
+  const u64 period = 20 * Millisecond;
+
+  // The first frame sets up the grid, the next ones sleep until it
+  expect("fixed: first sleep", frame(pacer, 5 * Millisecond).sleep, 0);
+  const u64 start = g_now;
+  expect(
+      "fixed: sleep", frame(pacer, 5 * Millisecond).sleep, 15 * Millisecond);
+  expect("fixed: present", g_now, start + period);
+
+  // Less than a frame late, the next frame catches up on the same grid
+  expect("fixed: late sleep", frame(pacer, 25 * Millisecond).sleep, 0);
+  expect("fixed: catch up sleep",
+         frame(pacer, 5 * Millisecond).sleep,
+         10 * Millisecond);
+  expect("fixed: caught up", g_now, start + 3 * period);
+  expect("fixed: missed frames", pacer.getStats().missedFrames, 0);
+
+  // More than a frame late, a new grid starts at the late present
+  frame(pacer, 50 * Millisecond);
+  const u64 restart = g_now;
+  expect("fixed: missed frames", pacer.getStats().missedFrames, 1);
+  expect("fixed: sleep after overrun",
+         frame(pacer, 5 * Millisecond).sleep,
+         15 * Millisecond);
+  expect("fixed: new grid", g_now, restart + period);
+  expect("fixed: frames", pacer.getStats().frames, 6);
+}
+
+void checkLowLatency()
+{
+  FramePacer pacer([] { return g_now; });
+  pacer.configure(PacingMode::LowLatency, 60);
+  const u64 period = FramePacer::VSyncPeriod;
+
+  expect("low latency: delay before the first present",
+         pacer.getStartDelay(),
+         0);
+
+  const FramePacer::Present present = frame(pacer, 4 * Millisecond);
+  expect("low latency: sleep", present.sleep, 0);
+  expect("low latency: vsyncs", present.vsyncs, 1);
+
+  // Done rendering the margin before the next vsync
+  expect("low latency: delay",
+         pacer.getStartDelay(),
+         period - 4 * Millisecond - FramePacer::LowLatencyMargin);
+
+  g_now += 1 * Millisecond;
+  expect("low latency: delay later",
+         pacer.getStartDelay(),
+         period - 5 * Millisecond - FramePacer::LowLatencyMargin);
+
+  // Slow frames start right away
+  pacer.resetStats();
+  frame(pacer, period);
+  expect("low latency: delay for slow frames", pacer.getStartDelay(), 0);
+}
+
+void checkVSync()
+{
+  FramePacer pacer([] { return g_now; });
+  pacer.configure(PacingMode::VSync, 30);
+  const u64 interval = 2 * FramePacer::VSyncPeriod;
+
+  for (u32 i = 0; i < 4; i++) {
+    const FramePacer::Present present = frame(pacer, 3 * Millisecond);
+    expect("vsync: sleep", present.sleep, 0);
+    expect("vsync: vsyncs", present.vsyncs, 2);
+  }
+
+  const FramePacer::Stats& stats = pacer.getStats();
+  expect("vsync: frames", stats.frames, 4);
+  expect("vsync: frame time", stats.lastFrameTime, interval);
+  expect("vsync: average frame time", stats.averageFrameTime, interval);
+  expect("vsync: jitter", stats.jitter, 0);
+  expect("vsync: missed frames", stats.missedFrames, 0);
+  expect("vsync: render time", stats.averageRenderTime, 3 * Millisecond);
+
+  // A frame that takes four vsyncs instead of two
+  pacer.onFrameStart();
+  g_now += 2 * interval;
+  pacer.onFrameEnd();
+  pacer.onPresented();
+
+  const u64 average = interval + interval / 16;
+  expect("vsync: frame time", stats.lastFrameTime, 2 * interval);
+  expect("vsync: average frame time", stats.averageFrameTime, average);
+  expect("vsync: jitter", stats.jitter, 2 * interval - average);
+  expect("vsync: missed frames", stats.missedFrames, 1);
+}
+
+}  // namespace
+
+int main()
+{
+  checkFixedInterval();
+  checkLowLatency();
+  checkVSync();
+
+  if (g_failures != 0) {
+    std::printf("%u checks failed\n", g_failures);
+    return 1;
+  }
+
+  return 0;
+}
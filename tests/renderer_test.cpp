@@ -0,0 +1,242 @@
+//
+// Created by pugemon on 16.10.26.
+//
+// Renders the same frames on one thread and in tiles on several, and checks
+// that the presented framebuffers are byte for byte the same. The frames
+// touch every kind of draw call across tile edges, under scissors and with an
+// atlas small enough that glyphs get evicted before the tiles are rasterized.
+// Runs against the host libnx in tools/host with the font NIKOLA_HOST_FONT
+// names.
+//
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <switch.h>
+
+#include "nikola/tesla.hpp"
+
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "nikola/stb_truetype.h"
+
+namespace tsl::cfg
+{
+
+u16 LayerWidth = 0;
+u16 LayerHeight = 0;
+u16 LayerPosX = 0;
+u16 LayerPosY = 0;
+u16 FramebufferWidth = 0;
+u16 FramebufferHeight = 0;
+
+}  // namespace tsl::cfg
+
+namespace tsl::gfx
+{
+
+struct RendererTest
+{
+  using Scene = void (*)(Renderer& renderer);
+
+  /**
+   * @brief Renders a frame and returns the framebuffer that got presented
+   */
+  static std::vector<u8> render(Scene scene, u8 threads, bool linear)
+  {
+    Renderer& renderer = Renderer::get();
+    renderThreads = threads;
+    linearRendering = linear;
+
+    renderer.startFrame();
+    scene(renderer);
+    renderer.endFrame();
+
+    const size_t size = renderer.getFramebufferSize();
+    const u8 slot = (renderer.getCurrentFramebufferSlot()
+                     + renderer.getFramebufferCount() - 1)
+        % renderer.getFramebufferCount();
+    const u8* frame =
+        static_cast<const u8*>(renderer.m_framebuffer.buf) + slot * size;
+
+    return {frame, frame + size};
+  }
+
+  static void init()
+  {
+    // A few rows of glyphs at most, text evicts itself within a frame
+    glyphCacheSize = 0x2000;
+
+    Renderer::get().init();
+    Renderer::setOpacity(1.0F);
+  }
+
+  static void exit() { Renderer::get().exit(); }
+};
+
+}  // namespace tsl::gfx
+
+using namespace tsl::gfx;
+
+namespace
+{
+
+u32 g_failures = 0;
+
+void shapes(Renderer& renderer)
+{
+  renderer.fillScreen(Color(0x1, 0x2, 0x3, 0xD));
+
+  for (s16 i = 0; i < 40; i++)
+    renderer.drawRect(
+        i * 13 - 20,
+        i * 17 - 30,
+        37 + i,
+        23 + i * 2,
+        Color(i & 0xF, (i * 3) & 0xF, (i * 7) & 0xF, (i * 5) & 0xF));
+
+  for (s16 i = 0; i < 20; i++)
+    renderer.drawEmptyRect(
+        i * 21 + 1, i * 31 + 2, 40 + i, 20 + i, Color(0xF, i & 0xF, 3, 0xB));
+
+  renderer.drawRoundedRect(40, 380, 300, 90, 20, Color(0x4, 0x8, 0xC, 0xA));
+  renderer.drawCircle(224, 360, 70, Color(0xF, 0x0, 0x8, 0x9));
+  renderer.drawArc(100, 600, 50, 6, 30, 300, Color(0x0, 0xF, 0x8, 0xF));
+  renderer.drawGradientRect(
+      250, 520, 150, 150, Color(0xF, 0, 0, 0xF), Color(0, 0, 0xF, 0x5), true);
+  renderer.drawGradientRect(
+      10, 640, 400, 40, Color(0, 0xF, 0, 0x3), Color(0xF, 0xF, 0, 0xF), false);
+}
+
+void lines(Renderer& renderer)
+{
+  renderer.fillScreen(Color(0x2, 0x2, 0x2, 0xF));
+
+  for (s16 i = 0; i < 30; i++) {
+    renderer.drawLine(
+        10 + i * 7, 20, 400 - i * 3, 50 + i * 20, Color(0xF, 0xF, 0, 0xF));
+    renderer.drawAntiAliasedLine(
+        440 - i, 700 - i * 9, 5 + i * 4, 10 + i, Color(0, 0xF, 0xF, 0xA));
+  }
+  renderer.drawDashedLine(10, 300, 400, 350, 5, Color(0xF, 0, 0, 0xF));
+
+  for (s16 x = 0; x < 448; x += 3)
+    renderer.setPixel(x, 63 + x % 5, Color(0xF, 0xF, 0xF, 0xF));
+}
+
+void text(Renderer& renderer)
+{
+  renderer.fillScreen(Color(0, 0, 0, 0xD));
+
+  renderer.drawString("The quick brown fox jumps over the lazy dog.",
+                      false,
+                      5,
+                      40,
+                      20,
+                      Color(0xF, 0xF, 0xF, 0xF));
+  renderer.drawString("Several lines\nof text at\na larger size",
+                      false,
+                      10,
+                      100,
+                      45,
+                      Color(0xC, 0xE, 0x3, 0xB));
+  renderer.drawString(
+      "mono 0123456789", true, 10, 330, 23, Color(0xF, 0x8, 0x8, 0xF));
+
+  // Every size gets its own glyphs, far more than the atlas holds
+  for (u32 size = 10; size < 40; size += 3)
+    renderer.drawString("ABCDEFGHIJKLMNOPQRSTUVWXYZ abcdefghijklmnopqrstuvwxyz",
+                        false,
+                        (size * 7) % 60,
+                        340 + size * 9,
+                        size,
+                        Color(size & 0xF, 0xF, 0xF - (size & 0xF), 0xF));
+}
+
+void images(Renderer& renderer)
+{
+  renderer.fillScreen(Color(0x3, 0x5, 0x7, 0xF));
+
+  std::vector<u8> bitmap(37 * 29 * 4);
+  for (u32 i = 0; i < bitmap.size(); i++)
+    bitmap[i] = u8(i * 37 + 11);
+
+  renderer.drawBitmap(20, 30, 37, 29, bitmap.data());
+  renderer.drawBitmap(430, 700, 37, 29, bitmap.data());
+  renderer.drawBitmap(-10, -5, 37, 29, bitmap.data());
+
+  // Images have to stay alive until the frame ends
+  static const Image image(bitmap.data(), 37, 29);
+  for (s16 i = 0; i < 8; i++)
+    renderer.drawImage(40 + i * 47, 120 + i * 61, image);
+}
+
+void scissors(Renderer& renderer)
+{
+  renderer.fillScreen(Color(0, 0, 0, 0xF));
+
+  renderer.enableScissoring(50, 60, 100, 80);
+  renderer.drawRect(0, 0, 448, 720, Color(0xF, 0, 0, 0x8));
+  renderer.drawString(
+      "Clipped text here", false, 40, 100, 30, Color(0xF, 0xF, 0xF, 0xF));
+  renderer.disableScissoring();
+
+  renderer.pushClip(100, 200, 250, 300);
+  renderer.pushClip(60, 260, 200, 100);
+  renderer.drawCircle(150, 300, 90, Color(0, 0xF, 0, 0xC));
+  renderer.popClip();
+  renderer.drawLine(0, 0, 447, 719, Color(0xF, 0xF, 0, 0xF));
+  renderer.popClip();
+
+  renderer.drawRect(200, 200, 10, 10, Color(0, 0xF, 0, 0xF));
+}
+
+/**
+ * @brief Renders a scene on one thread and in tiles, then compares the
+ * presented frames
+ */
+void check(const char* name, RendererTest::Scene scene, bool linear)
+{
+  const std::vector<u8> expected = RendererTest::render(scene, 1, linear);
+
+  for (u8 threads : {2, 3, 4}) {
+    const std::vector<u8> frame = RendererTest::render(scene, threads, linear);
+
+    for (u32 i = 0; i < frame.size(); i++)
+      if (frame[i] != expected[i]) {
+        g_failures++;
+        std::printf("%s%s on %u threads: byte %u is 0x%02X, expected 0x%02X\n",
+                    name,
+                    linear ? " (linear)" : "",
+                    threads,
+                    i,
+                    frame[i],
+                    expected[i]);
+        break;
+      }
+  }
+}
+
+}  // namespace
+
+int main()
+{
+  RendererTest::init();
+
+  for (bool linear : {false, true}) {
+    check("shapes", shapes, linear);
+    check("lines", lines, linear);
+    check("text", text, linear);
+    check("images", images, linear);
+    check("scissors", scissors, linear);
+  }
+
+  RendererTest::exit();
+
+  if (g_failures != 0) {
+    std::printf("%u frames differ\n", g_failures);
+    return 1;
+  }
+
+  return 0;
+}
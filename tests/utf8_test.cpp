@@ -0,0 +1,213 @@
+//
+// Created by pugemon on 16.10.26.
+//
+// Checks decodeUtf8 against a byte by byte decoder written from the Unicode
+// table of well-formed sequences. Every codepoint gets encoded, surrounded by
+// runs of ASCII of every length so the vector path starts and stops at every
+// offset of a block, and every kind of malformed sequence has to stop
+// decoding. Built with SSE2 or NEON, whatever the host has, and once without
+// either for the scalar path.
+//
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <switch.h>
+
+#include "nikola/tesla/utf8.hpp"
+
+using namespace tsl::gfx;
+
+namespace
+{
+
+u32 g_failures = 0;
+
+/**
+ * @brief Decodes until the end or the first byte that doesn't start a
+ * well-formed sequence
+ */
+std::vector<u32> reference(const std::string& string)
+{
+  std::vector<u32> codepoints;
+
+  for (size_t i = 0; i < string.size();) {
+    const u8 lead = string[i];
+    u32 length = 0, codepoint = 0;
+    u8 low = 0x80, high = 0xBF;  // Range of the second byte
+
+    if (lead < 0x80)
+      length = 1, codepoint = lead;
+    else if (lead >= 0xC2 && lead <= 0xDF)
+      length = 2, codepoint = lead & 0x1F;
+    else if (lead >= 0xE0 && lead <= 0xEF) {
+      length = 3, codepoint = lead & 0x0F;
+      if (lead == 0xE0)
+        low = 0xA0;
+      else if (lead == 0xED)
+        high = 0x9F;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+      length = 4, codepoint = lead & 0x07;
+      if (lead == 0xF0)
+        low = 0x90;
+      else if (lead == 0xF4)
+        high = 0x8F;
+    } else
+      break;
+
+    if (i + length > string.size())
+      break;
+
+    bool valid = true;
+    for (u32 j = 1; j < length; j++) {
+      const u8 byte = string[i + j];
+      valid &= j == 1 ? byte >= low && byte <= high
+                      : byte >= 0x80 && byte <= 0xBF;
+      codepoint = codepoint << 6 | (byte & 0x3F);
+    }
+    if (!valid)
+      break;
+
+    codepoints.push_back(codepoint);
+    i += length;
+  }
+
+  return codepoints;
+}
+
+std::string encode(u32 codepoint)
+{
+  std::string bytes;
+
+  if (codepoint < 0x80)
+    bytes += char(codepoint);
+  else if (codepoint < 0x800) {
+    bytes += char(0xC0 | codepoint >> 6);
+    bytes += char(0x80 | (codepoint & 0x3F));
+  } else if (codepoint < 0x10000) {
+    bytes += char(0xE0 | codepoint >> 12);
+    bytes += char(0x80 | ((codepoint >> 6) & 0x3F));
+    bytes += char(0x80 | (codepoint & 0x3F));
+  } else {
+    bytes += char(0xF0 | codepoint >> 18);
+    bytes += char(0x80 | ((codepoint >> 12) & 0x3F));
+    bytes += char(0x80 | ((codepoint >> 6) & 0x3F));
+    bytes += char(0x80 | (codepoint & 0x3F));
+  }
+
+  return bytes;
+}
+
+std::string ascii(u32 length, u32 seed)
+{
+  std::string bytes;
+  for (u32 i = 0; i < length; i++)
+    bytes += char(0x20 + (seed + i * 7) % 0x5F);
+
+  return bytes;
+}
+
+void check(const char* name, const std::string& string)
+{
+  std::vector<u32> codepoints = {0xDEAD};
+  decodeUtf8(string, codepoints);
+
+  const std::vector<u32> expected = reference(string);
+  if (codepoints == expected)
+    return;
+
+  if (g_failures++ < 20) {
+    size_t i = 0;
+    while (i < codepoints.size() && i < expected.size()
+           && codepoints[i] == expected[i])
+      i++;
+
+    std::printf("%s: %zu codepoints instead of %zu, first difference at %zu\n",
+                name,
+                codepoints.size(),
+                expected.size(),
+                i);
+  }
+}
+
+void checkCodepoints()
+{
+  // Long runs of valid text, so the vector path runs between the sequences
+  std::string text;
+  for (u32 codepoint = 0; codepoint <= 0x10FFFF; codepoint++) {
+    if (codepoint >= 0xD800 && codepoint <= 0xDFFF)
+      continue;
+
+    text += encode(codepoint);
+    text += ascii(codepoint % 37, codepoint);
+
+    if (text.size() > 0x10000) {
+      check("codepoints", text);
+      text.clear();
+    }
+  }
+  check("codepoints", text);
+}
+
+void checkBlocks()
+{
+  // A non-ASCII sequence at every offset of the first blocks, and strings
+  // ending at every offset
+  const std::string sequences[] = {
+      encode(0xE9), encode(0x20AC), encode(0x1F600)};
+
+  for (u32 length = 0; length < 64; length++) {
+    check("ascii", ascii(length, length));
+
+    for (const std::string& sequence : sequences)
+      for (u32 offset = 0; offset <= length; offset++) {
+        std::string string = ascii(length, offset);
+        string.insert(offset, sequence);
+        check("blocks", string);
+      }
+  }
+}
+
+void checkMalformed()
+{
+  const std::string malformed[] = {
+      "\x80",  // Continuation without a lead byte
+      "\xBF",
+      "\xC0\xAF",  // Overlong
+      "\xC1\xBF",
+      "\xE0\x9F\xBF",
+      "\xF0\x8F\xBF\xBF",
+      "\xED\xA0\x80",  // Surrogates
+      "\xED\xBF\xBF",
+      "\xF4\x90\x80\x80",  // Past U+10FFFF
+      "\xF5\x80\x80\x80",
+      "\xFF",
+      "\xC3",  // Truncated
+      "\xE2\x82",
+      "\xF0\x9F\x98",
+      "\xC3\x28",  // Missing continuation
+      "\xE2\x28\xA1",
+      "\xF0\x9F\x28\x80",
+  };
+
+  // Stops right at the sequence, wherever it is in a block
+  for (const std::string& sequence : malformed)
+    for (u32 offset = 0; offset < 40; offset++)
+      check("malformed", ascii(offset, offset) + sequence + ascii(40, 1));
+}
+
+}  // namespace
+
+int main()
+{
+  checkCodepoints();
+  checkBlocks();
+  checkMalformed();
+
+  if (g_failures != 0) {
+    std::printf("%u strings decoded differently\n", g_failures);
+    return 1;
+  }
+
+  return 0;
+}
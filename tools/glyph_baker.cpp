@@ -0,0 +1,185 @@
+//
+// Created by pugemon on 16.10.26.
+//
+// Rasterizes common glyphs into a header that gets compiled into libnikola,
+// see cmake/bake-glyphs.cmake. Runs on the build machine, so it only depends
+// on the standard library and stb_truetype.
+//
+// Usage: glyph_baker std.ttf ext.ttf output.hpp pixel_height...
+//
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "nikola/stb_truetype.h"
+
+namespace
+{
+
+// Printable ASCII and the button icons of the extended font
+constexpr std::pair<uint32_t, uint32_t> CodepointRanges[] = {
+    {0x20, 0x7E},
+    {0xE0A0, 0xE0FF},
+};
+
+bool readFile(const char* path, std::vector<unsigned char>& data)
+{
+  FILE* file = std::fopen(path, "rb");
+  if (file == nullptr)
+    return false;
+
+  std::fseek(file, 0, SEEK_END);
+  data.resize(std::ftell(file));
+  std::rewind(file);
+
+  const bool read =
+      std::fread(data.data(), 1, data.size(), file) == data.size();
+  std::fclose(file);
+
+  return read && !data.empty();
+}
+
+// Same as tsl::gfx::fingerprintFont in font_metrics.cpp
+uint32_t fingerprintFont(const stbtt_fontinfo& font)
+{
+  const unsigned char* directory = font.data + font.fontstart;
+  const uint32_t tableCount = directory[4] << 8 | directory[5];
+
+  uint32_t hash = 0x811C9DC5;
+  for (uint32_t i = 0; i < 12 + 16 * tableCount; i++)
+    hash = (hash ^ directory[i]) * 0x01000193;
+
+  return hash;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  if (argc < 5) {
+    std::fprintf(stderr,
+                 "usage: %s std.ttf ext.ttf output.hpp pixel_height...\n",
+                 argv[0]);
+    return 1;
+  }
+
+  // Same fallback order as tsl::gfx::FontMetrics, extended font first
+  std::vector<unsigned char> data[2];
+  stbtt_fontinfo fonts[2];
+  const char* paths[2] = {argv[2], argv[1]};
+
+  for (int i = 0; i < 2; i++) {
+    if (!readFile(paths[i], data[i])
+        || !stbtt_InitFont(&fonts[i],
+                           data[i].data(),
+                           stbtt_GetFontOffsetForIndex(data[i].data(), 0)))
+    {
+      std::fprintf(stderr, "%s: can't load font\n", paths[i]);
+      return 1;
+    }
+  }
+
+  std::string glyphs, coverage;
+  uint32_t offset = 0, count = 0;
+  std::vector<unsigned char> bitmap;
+
+  for (int arg = 4; arg < argc; arg++) {
+    const int pixelHeight = std::atoi(argv[arg]);
+    if (pixelHeight <= 0 || pixelHeight > 0xFF) {
+      std::fprintf(stderr, "%s: invalid pixel height\n", argv[arg]);
+      return 1;
+    }
+
+    for (const auto& [first, last] : CodepointRanges) {
+      for (uint32_t codepoint = first; codepoint <= last; codepoint++) {
+        int font = 0;
+        if (stbtt_FindGlyphIndex(&fonts[font], codepoint) == 0)
+          font = 1;
+        if (stbtt_FindGlyphIndex(&fonts[font], codepoint) == 0)
+          continue;
+
+        // Same scale as FontMetrics::Font::getScale
+        int ascent = 0, descent = 0, lineGap = 0;
+        stbtt_GetFontVMetrics(&fonts[font], &ascent, &descent, &lineGap);
+        const float scale =
+            float(pixelHeight) / static_cast<float>(ascent - descent);
+
+        int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+        stbtt_GetCodepointBitmapBox(
+            &fonts[font], codepoint, scale, scale, &x0, &y0, &x1, &y1);
+
+        const int width = x1 - x0, height = y1 - y0;
+        if (width <= 0 || height <= 0)
+          continue;
+
+        bitmap.assign(width * height, 0);
+        stbtt_MakeCodepointBitmap(&fonts[font],
+                                  bitmap.data(),
+                                  width,
+                                  height,
+                                  width,
+                                  scale,
+                                  scale,
+                                  codepoint);
+
+        // Two 4 bit coverage values per byte, like GlyphCache stores them
+        char line[128];
+        for (int row = 0; row < height; row++) {
+          coverage += "   ";
+          for (int col = 0; col < width; col += 2) {
+            const unsigned char* pixel = &bitmap[row * width + col];
+            const int packed = (pixel[0] >> 4)
+                | (col + 1 < width ? pixel[1] & 0xF0 : 0);
+            std::snprintf(line, sizeof(line), " 0x%02X,", packed);
+            coverage += line;
+          }
+          coverage += "\n";
+        }
+
+        std::snprintf(line,
+                      sizeof(line),
+                      "    {0x%04X, %d, %d, %d, %d, %d, %d, %u},\n",
+                      codepoint,
+                      font,
+                      pixelHeight,
+                      x0,
+                      y0,
+                      width,
+                      height,
+                      offset);
+        glyphs += line;
+
+        offset += (width + 1) / 2 * height;
+        count++;
+      }
+    }
+  }
+
+  FILE* output = std::fopen(argv[3], "w");
+  if (output == nullptr) {
+    std::fprintf(stderr, "%s: can't write output\n", argv[3]);
+    return 1;
+  }
+
+  std::fprintf(output,
+               "// Generated by tools/glyph_baker.cpp, do not edit\n"
+               "#pragma once\n\n"
+               "namespace tsl::gfx::baked\n{\n\n"
+               "inline constexpr u32 FontFingerprints[] = {0x%08X, 0x%08X};\n\n"
+               "inline constexpr BakedGlyph Glyphs[] = {\n%s};\n\n"
+               "inline constexpr u8 Coverage[] = {\n%s};\n\n"
+               "}  // namespace tsl::gfx::baked\n",
+               fingerprintFont(fonts[0]),
+               fingerprintFont(fonts[1]),
+               glyphs.c_str(),
+               coverage.c_str());
+  std::fclose(output);
+
+  std::printf("%s: %u glyphs, %u bytes of coverage\n", argv[3], count, offset);
+
+  return 0;
+}
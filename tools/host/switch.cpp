@@ -0,0 +1,223 @@
+//
+// Created by pugemon on 16.10.26.
+//
+// Host versions of the libnx functions declared in switch.h. Services accept
+// everything, framebuffers live in memory and both shared fonts get loaded
+// from the file NIKOLA_HOST_FONT names.
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <switch.h>
+
+extern "C" u64 __nx_vi_layer_id;
+u64 __nx_vi_layer_id = 0;
+
+Result smInitialize()
+{
+  return 0;
+}
+
+void smExit() {}
+
+Result serviceClone(Service* service, Service* out)
+{
+  *out = *service;
+  return 0;
+}
+
+void serviceClose(Service*) {}
+
+bool hosversionAtLeast(u8, u8, u8)
+{
+  return true;
+}
+
+Service* hidsysGetServiceSession()
+{
+  static Service service;
+  return &service;
+}
+
+// No applet or application runs next to the host process
+Result pmdmntGetProcessId(u64* pid_out, u64)
+{
+  *pid_out = 0;
+  return 0;
+}
+
+Result pmdmntGetApplicationProcessId(u64* pid_out)
+{
+  *pid_out = 0;
+  return 0;
+}
+
+void fatalThrow(Result res)
+{
+  std::fprintf(stderr, "fatalThrow(0x%X)\n", res);
+  std::abort();
+}
+
+Result eventWait(Event*, u64)
+{
+  return 0;
+}
+
+void eventClose(Event*) {}
+
+void svcSleepThread(s64 nano)
+{
+  if (nano > 0)
+    std::this_thread::sleep_for(std::chrono::nanoseconds(nano));
+}
+
+u64 armGetSystemTick()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+u64 armTicksToNs(u64 tick)
+{
+  return tick;
+}
+
+Result viInitialize(ViServiceType)
+{
+  return 0;
+}
+
+void viExit() {}
+
+Result viOpenDefaultDisplay(ViDisplay* display)
+{
+  display->display_id = 0;
+  return 0;
+}
+
+Result viCloseDisplay(ViDisplay*)
+{
+  return 0;
+}
+
+Result viGetDisplayVsyncEvent(ViDisplay*, Event* event_out)
+{
+  event_out->revent = 0;
+  return 0;
+}
+
+Result viCreateManagedLayer(const ViDisplay*, ViLayerFlags, u64, u64* layer_id)
+{
+  *layer_id = 1;
+  return 0;
+}
+
+Result viCreateLayer(const ViDisplay*, ViLayer* layer)
+{
+  layer->layer_id = __nx_vi_layer_id;
+  return 0;
+}
+
+Result viDestroyManagedLayer(ViLayer*)
+{
+  return 0;
+}
+
+Result viSetLayerScalingMode(ViLayer*, ViScalingMode)
+{
+  return 0;
+}
+
+Result viGetZOrderCountMax(ViDisplay*, s32* z)
+{
+  *z = 0;
+  return 0;
+}
+
+Result viSetLayerZ(ViLayer*, s32)
+{
+  return 0;
+}
+
+Result viSetLayerSize(ViLayer*, s32, s32)
+{
+  return 0;
+}
+
+Result viSetLayerPosition(ViLayer*, float, float)
+{
+  return 0;
+}
+
+Service* viGetSession_IManagerDisplayService()
+{
+  static Service service;
+  return &service;
+}
+
+Result nwindowCreateFromLayer(NWindow* nw, const ViLayer*)
+{
+  nw->cur_slot = 0;
+  return 0;
+}
+
+void nwindowClose(NWindow*) {}
+
+Result framebufferCreate(
+    Framebuffer* fb, NWindow* win, u32 width, u32 height, u32, u32 num_fbs)
+{
+  // Block linear buffers are padded to whole 128 row blocks
+  fb->win = win;
+  fb->fb_size = width * ((height + 127) / 128 * 128) * sizeof(u16);
+  fb->num_fbs = num_fbs;
+  fb->buf = std::calloc(num_fbs, fb->fb_size);
+
+  return fb->buf != nullptr ? 0 : 1;
+}
+
+void framebufferClose(Framebuffer* fb)
+{
+  std::free(fb->buf);
+  fb->buf = nullptr;
+}
+
+void* framebufferBegin(Framebuffer* fb, u32* out_stride)
+{
+  if (out_stride != nullptr)
+    *out_stride = fb->fb_size;
+
+  return static_cast<u8*>(fb->buf) + fb->win->cur_slot * fb->fb_size;
+}
+
+void framebufferEnd(Framebuffer* fb)
+{
+  fb->win->cur_slot = (fb->win->cur_slot + 1) % fb->num_fbs;
+}
+
+Result plGetSharedFontByType(PlFontData* font, PlSharedFontType type)
+{
+  const char* path = std::getenv("NIKOLA_HOST_FONT");
+  std::FILE* file = path != nullptr ? std::fopen(path, "rb") : nullptr;
+  if (file == nullptr)
+    return 1;
+
+  std::fseek(file, 0, SEEK_END);
+  const long size = std::ftell(file);
+  std::rewind(file);
+
+  // Stays loaded for the rest of the process, like the shared memory
+  void* data = std::malloc(size);
+  const bool read =
+      data != nullptr && std::fread(data, 1, size, file) == size_t(size);
+  std::fclose(file);
+
+  if (!read) {
+    std::free(data);
+    return 1;
+  }
+
+  *font = {static_cast<u32>(type), 0, static_cast<u32>(size), data};
+  return 0;
+}
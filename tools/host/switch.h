@@ -0,0 +1,261 @@
+//
+// Created by pugemon on 16.10.26.
+//
+// Stands in for libnx when tests and benchmarks get built for the build
+// machine. Declares the parts of libnx the library uses, with the same names
+// and signatures. Tests that link the renderer also build switch.cpp, which
+// implements the functions with framebuffers in memory, a vsync that never
+// blocks and fonts loaded from the file in NIKOLA_HOST_FONT.
+//
+#ifndef LIBNIKOLA_HOST_SWITCH_H
+#define LIBNIKOLA_HOST_SWITCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef u32 Result;
+typedef u32 Handle;
+
+#define R_SUCCEEDED(res) ((res) == 0)
+#define R_FAILED(res) ((res) != 0)
+
+#define NX_PACKED __attribute__((packed))
+
+#define BIT(n) (1U << (n))
+#define BITL(n) (1ULL << (n))
+
+#define PIXEL_FORMAT_RGBA_4444 7
+
+// Services
+
+struct Service
+{
+  Handle session;
+};
+
+Result smInitialize();
+void smExit();
+
+Result serviceClone(Service* service, Service* out);
+void serviceClose(Service* service);
+
+/**
+ * @brief Sends a request to a service, the host version drops it
+ */
+template<typename In>
+Result serviceDispatchIn(Service*, u32, const In&)
+{
+  return 0;
+}
+
+bool hosversionAtLeast(u8 major, u8 minor, u8 micro);
+
+Service* hidsysGetServiceSession();
+
+Result pmdmntGetProcessId(u64* pid_out, u64 program_id);
+Result pmdmntGetApplicationProcessId(u64* pid_out);
+
+[[noreturn]] void fatalThrow(Result res);
+
+// Time and synchronization
+
+struct Event
+{
+  Handle revent;
+};
+
+Result eventWait(Event* event, u64 timeout);
+void eventClose(Event* event);
+
+void svcSleepThread(s64 nano);
+
+u64 armGetSystemTick();
+u64 armTicksToNs(u64 tick);
+
+// Display
+
+struct ViDisplay
+{
+  u64 display_id;
+};
+
+struct ViLayer
+{
+  u64 layer_id;
+};
+
+struct NWindow
+{
+  u32 cur_slot;
+};
+
+struct Framebuffer
+{
+  NWindow* win;
+  void* buf;
+  u32 fb_size;
+  u32 num_fbs;
+};
+
+enum ViServiceType
+{
+  ViServiceType_Manager = 2,
+};
+
+enum ViLayerFlags
+{
+  ViLayerFlags_Default = BIT(0),
+};
+
+enum ViScalingMode
+{
+  ViScalingMode_FitToLayer = 2,
+};
+
+enum ViLayerStack
+{
+  ViLayerStack_Default = 0,
+  ViLayerStack_Lcd = 1,
+  ViLayerStack_Screenshot = 2,
+  ViLayerStack_Recording = 3,
+  ViLayerStack_LastFrame = 4,
+  ViLayerStack_Arbitrary = 5,
+  ViLayerStack_ApplicationForDebug = 6,
+  ViLayerStack_Null = 10,
+};
+
+Result viInitialize(ViServiceType service_type);
+void viExit();
+Result viOpenDefaultDisplay(ViDisplay* display);
+Result viCloseDisplay(ViDisplay* display);
+Result viGetDisplayVsyncEvent(ViDisplay* display, Event* event_out);
+Result viCreateManagedLayer(const ViDisplay* display,
+                            ViLayerFlags layer_flags,
+                            u64 aruid,
+                            u64* layer_id);
+Result viCreateLayer(const ViDisplay* display, ViLayer* layer);
+Result viDestroyManagedLayer(ViLayer* layer);
+Result viSetLayerScalingMode(ViLayer* layer, ViScalingMode scaling_mode);
+Result viGetZOrderCountMax(ViDisplay* display, s32* z);
+Result viSetLayerZ(ViLayer* layer, s32 z);
+Result viSetLayerSize(ViLayer* layer, s32 width, s32 height);
+Result viSetLayerPosition(ViLayer* layer, float x, float y);
+Service* viGetSession_IManagerDisplayService();
+
+Result nwindowCreateFromLayer(NWindow* nw, const ViLayer* layer);
+void nwindowClose(NWindow* nw);
+
+Result framebufferCreate(Framebuffer* fb,
+                         NWindow* win,
+                         u32 width,
+                         u32 height,
+                         u32 format,
+                         u32 num_fbs);
+void framebufferClose(Framebuffer* fb);
+void* framebufferBegin(Framebuffer* fb, u32* out_stride);
+void framebufferEnd(Framebuffer* fb);
+
+// Fonts
+
+enum PlServiceType
+{
+  PlServiceType_User = 0,
+  PlServiceType_System = 1,
+};
+
+enum PlSharedFontType
+{
+  PlSharedFontType_Standard = 0,
+  PlSharedFontType_NintendoExt = 5,
+};
+
+struct PlFontData
+{
+  u32 type;
+  u32 offset;
+  u32 size;
+  void* address;
+};
+
+Result plGetSharedFontByType(PlFontData* font, PlSharedFontType type);
+
+// Input
+
+enum AppletType
+{
+  AppletType_None = -2,
+};
+
+enum HidNpadButton : u64
+{
+  HidNpadButton_A = BITL(0),
+  HidNpadButton_B = BITL(1),
+  HidNpadButton_X = BITL(2),
+  HidNpadButton_Y = BITL(3),
+  HidNpadButton_StickL = BITL(4),
+  HidNpadButton_StickR = BITL(5),
+  HidNpadButton_L = BITL(6),
+  HidNpadButton_R = BITL(7),
+  HidNpadButton_ZL = BITL(8),
+  HidNpadButton_ZR = BITL(9),
+  HidNpadButton_Plus = BITL(10),
+  HidNpadButton_Minus = BITL(11),
+  HidNpadButton_Left = BITL(12),
+  HidNpadButton_Up = BITL(13),
+  HidNpadButton_Right = BITL(14),
+  HidNpadButton_Down = BITL(15),
+  HidNpadButton_StickLLeft = BITL(16),
+  HidNpadButton_StickLUp = BITL(17),
+  HidNpadButton_StickLRight = BITL(18),
+  HidNpadButton_StickLDown = BITL(19),
+  HidNpadButton_StickRLeft = BITL(20),
+  HidNpadButton_StickRUp = BITL(21),
+  HidNpadButton_StickRRight = BITL(22),
+  HidNpadButton_StickRDown = BITL(23),
+  HidNpadButton_AnySL = BITL(24) | BITL(26),
+  HidNpadButton_AnySR = BITL(25) | BITL(27),
+};
+
+struct HidTouchState
+{
+  u64 delta_time;
+  u32 attributes;
+  u32 finger_id;
+  u32 x;
+  u32 y;
+  u32 diameter_x;
+  u32 diameter_y;
+  u32 rotation_angle;
+  u32 reserved;
+};
+
+struct HidTouchScreenState
+{
+  u64 sampling_number;
+  s32 count;
+  u32 reserved;
+  HidTouchState touches[16];
+};
+
+struct HidAnalogStickState
+{
+  s32 x;
+  s32 y;
+};
+
+struct PadState
+{
+  u64 buttons_cur;
+  u64 buttons_old;
+};
+
+#endif  // LIBNIKOLA_HOST_SWITCH_H
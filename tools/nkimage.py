@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""Converts images into the libnikola image format loaded by tsl::gfx::Image.
+
+Pixels are quantized to premultiplied RGBA4444 the same way Image::load
+converts a bitmap at runtime, so the overlay only has to read the file.
+
+Usage: nkimage.py [--raw] input.png output.nki
+"""
+
+import argparse
+import struct
+import sys
+
+from PIL import Image
+
+MAGIC = b"NKIM"
+VERSION = 1
+FLAG_RUN_LENGTH = 1 << 0
+MAX_RUN = 0x8000
+
+
+def quantize(image):
+    """Returns the premultiplied RGBA4444 pixels of an image, row by row."""
+    pixels = []
+    for r, g, b, a in image.convert("RGBA").getdata():
+        a >>= 4
+        # Same floor division by 15 as Image::load
+        r, g, b = ((c >> 4) * a // 15 for c in (r, g, b))
+        pixels.append(r | g << 4 | b << 8 | a << 12)
+    return pixels
+
+
+def encode_run_length(pixels):
+    """Encodes pixels as packets of repeated or literal pixels."""
+    out = bytearray()
+    literal = []
+
+    def flush_literal():
+        while literal:
+            chunk = literal[:MAX_RUN]
+            del literal[:MAX_RUN]
+            out.extend(struct.pack("<H", len(chunk) - 1))
+            out.extend(struct.pack(f"<{len(chunk)}H", *chunk))
+
+    i = 0
+    while i < len(pixels):
+        run = 1
+        while (i + run < len(pixels) and run < MAX_RUN
+               and pixels[i + run] == pixels[i]):
+            run += 1
+
+        # A run packet takes 4 bytes, only worth it from 3 pixels on
+        if run >= 3:
+            flush_literal()
+            out.extend(struct.pack("<HH", 0x8000 | (run - 1), pixels[i]))
+        else:
+            literal.extend(pixels[i:i + run])
+        i += run
+
+    flush_literal()
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="any image Pillow can open")
+    parser.add_argument("output", help="libnikola image file to write")
+    parser.add_argument("--raw", action="store_true",
+                        help="store the pixels without run length encoding")
+    args = parser.parse_args()
+
+    image = Image.open(args.input)
+    if image.width > 0xFFFF or image.height > 0xFFFF:
+        sys.exit(f"{args.input}: image is too large")
+
+    pixels = quantize(image)
+    raw = struct.pack(f"<{len(pixels)}H", *pixels)
+    encoded = None if args.raw else encode_run_length(pixels)
+
+    # Run length encoding only pays off for images with flat areas
+    if encoded is not None and len(encoded) < len(raw):
+        flags, data = FLAG_RUN_LENGTH, encoded
+    else:
+        flags, data = 0, raw
+
+    with open(args.output, "wb") as output:
+        output.write(struct.pack("<4sBBHHHI", MAGIC, VERSION, flags,
+                                 image.width, image.height, 0, len(data)))
+        output.write(data)
+
+    print(f"{args.output}: {image.width}x{image.height}, {16 + len(data)} "
+          f"bytes ({'run length' if flags else 'raw'})")
+
+
+if __name__ == "__main__":
+    main()